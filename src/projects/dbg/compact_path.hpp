@@ -47,6 +47,26 @@ namespace dbg {
             _edges = Sequence(edges);
         }
 
+//        Path stored in buffer by GraphAligner::align and its reverse complement. Edge nucleotides are copied to arena,
+//        so no memory is allocated for each path.
+        static CompactPath FromBuffer(AlignmentBuffer &buffer, SequenceArena &arena) {
+            if(buffer.edges.empty())
+                return {};
+            buffer.nucls.clear();
+            for(const Edge *edge : buffer.edges)
+                buffer.nucls.append(char(edge->seq[0]));
+            return {*buffer.start, buffer.nucls.BuildSequence(arena), buffer.left_skip, buffer.right_skip};
+        }
+
+        static CompactPath RCFromBuffer(AlignmentBuffer &buffer, SequenceArena &arena) {
+            if(buffer.edges.empty())
+                return {};
+            buffer.nucls.clear();
+            for(auto it = buffer.edges.rbegin(); it != buffer.edges.rend(); ++it)
+                buffer.nucls.append(char((*it)->rc().seq[0]));
+            return {buffer.edges.back()->end()->rc(), buffer.nucls.BuildSequence(arena), buffer.right_skip, buffer.left_skip};
+        }
+
         bool valid() const {
             return _start != nullptr;
         }
@@ -3,28 +3,35 @@
 
 using namespace hashing;
 using namespace dbg;
-std::vector<hashing::htype>
-findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
-              size_t threads) {
-    bloom_parameters parameters;
-    parameters.projected_element_count = std::max(total_size(disjointigs) - hasher.getK() * disjointigs.size(), size_t(1000));
+
+//Long disjointigs are split into overlapping pieces of 20k nucleotides to balance work between threads
+static std::vector<Sequence> splitDisjointigs(const std::vector<Sequence> &disjointigs, size_t k) {
     std::vector<Sequence> split_disjointigs;
     for(const Sequence &seq : disjointigs) {
-        if(seq.size() > hasher.getK() * 20) {
+        if(seq.size() > k * 20) {
             size_t cur = 0;
-            while(cur + hasher.getK() < seq.size()) {
-                split_disjointigs.emplace_back(seq.Subseq(cur, std::min(seq.size(), cur + hasher.getK() * 20)));
-                cur += hasher.getK() * 19;
+            while(cur + k < seq.size()) {
+                split_disjointigs.emplace_back(seq.Subseq(cur, std::min(seq.size(), cur + k * 20)));
+                cur += k * 19;
             }
         } else {
             split_disjointigs.emplace_back(seq);
         }
     }
+    return std::move(split_disjointigs);
+}
+
+std::vector<hashing::htype>
+findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
+              size_t threads) {
+    bloom_parameters parameters;
+    parameters.projected_element_count = std::max(total_size(disjointigs) - hasher.getK() * disjointigs.size(), size_t(1000));
+    std::vector<Sequence> split_disjointigs = splitDisjointigs(disjointigs, hasher.getK());
     parameters.false_positive_probability = 0.0001;
     VERIFY(!!parameters);
     parameters.compute_optimal_parameters();
-    BloomFilter filter(parameters);
-//    DelayedBloomFilter filter(parameters, threads);
+    double start_time = omp_get_wtime();
+    BlockedBloomFilter filter(parameters);
     const hashing::RollingHash ehasher = hasher.extensionHash();
     std::function<void(size_t, const Sequence &)> task = [&filter, &ehasher](size_t pos, const Sequence & seq) {
         if(seq.size() < ehasher.getK())
@@ -32,38 +39,35 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
         hashing::KWH kmer(ehasher, seq, 0);
         while (true) {
             filter.insert(kmer.hash());
-//            filter.delayedInsert(kmer.hash());
             if (!kmer.hasNext())
                 break;
             kmer = kmer.next();
         }
     };
     logger.info() << "Filling bloom filter with k+1-mers." << std::endl;
-//    ParallelProcessor<Sequence> fill_processor(task, logger, threads);
-//    fill_processor.doAfter = [&filter, threads]() {
-//        filter.dump(threads);
-//    };
-//    fill_processor.processRecords(split_disjointigs.begin(), split_disjointigs.end());
     processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, task);
     std::pair<size_t, size_t> bits = filter.count_bits();
     logger.info() << "Filled " << bits.first << " bits out of " << bits.second << std::endl;
+    logger.trace() << "Sampled bloom filter false positive rate " << filter.sampled_fpp() << std::endl;
     logger.info() << "Finished filling bloom filter. Selecting junctions." << std::endl;
     ParallelRecordCollector<hashing::htype> junctions(threads);
     std::function<void(size_t, const Sequence &)> junk_task = [&filter, &hasher, &junctions](size_t pos, const Sequence & seq) {
         KWH kmer(hasher, seq, 0);
         size_t cnt = 0;
+        hashing::htype ext[8];
+        bool found[8];
         while (true) {
-            size_t cnt1 = 0;
-            size_t cnt2 = 0;
             for (unsigned char c = 0; c < 4u; c++) {
-                cnt1 += filter.contains(kmer.extendRight(c));
-                cnt2 += filter.contains(kmer.extendLeft(c));
+                ext[c] = kmer.extendRight(c);
+                ext[c + 4] = kmer.extendLeft(c);
             }
+            filter.containsAll(ext, 8, found);
+            size_t cnt1 = found[0] + found[1] + found[2] + found[3];
+            size_t cnt2 = found[4] + found[5] + found[6] + found[7];
             if (cnt1 != 1 || cnt2 != 1) {
                 cnt += 1;
                 junctions.emplace_back(kmer.hash());
             }
-            VERIFY(cnt1 <= 4 && cnt2 <= 4);
             if (!kmer.hasNext())
                 break;
             kmer = kmer.next();
@@ -78,24 +82,141 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
     __gnu_parallel::sort(res.begin(), res.end());
     res.erase(std::unique(res.begin(), res.end()), res.end());
     logger.info() << "Collected " << res.size() << " junctions." << std::endl;
+    logger.trace() << "Junction search took " << omp_get_wtime() - start_time << " seconds" << std::endl;
+    return res;
+}
+
+//Canonical k-mer hash together with nucleotides that follow (bits 0-3) and precede (bits 4-7) it in canonical orientation
+struct KmerExtensions {
+    htype hash;
+    unsigned char mask;
+
+    bool operator<(const KmerExtensions &other) const {
+        return hash < other.hash;
+    }
+};
+
+//Collects records for k-mers that belong to the given partition. Equal k-mers are not merged.
+static std::vector<KmerExtensions> collectKmerExtensions(logging::Logger &logger, const std::vector<Sequence> &split_disjointigs,
+                                                          const hashing::RollingHash &hasher, size_t threads,
+                                                          size_t part, size_t parts) {
+    const size_t k = hasher.getK();
+    hashing::alt_hasher<htype> part_hasher;
+    ParallelRecordCollector<KmerExtensions> records(threads);
+    std::function<void(size_t, const Sequence &)> task = [&records, &hasher, &part_hasher, k, part, parts](size_t pos, const Sequence & seq) {
+        if(seq.size() < k)
+            return;
+        std::vector<KmerExtensions> buf;
+        KWH kmer(hasher, seq, 0);
+        while (true) {
+            htype hash = kmer.hash();
+            if(part_hasher(hash) % parts == part) {
+                unsigned char next = kmer.hasNext() ? 1u << seq[kmer.pos + k] : 0;
+                unsigned char prev = kmer.hasPrev() ? 1u << seq[kmer.pos - 1] : 0;
+                unsigned char mask = 0;
+                if(kmer.fHash() <= kmer.rHash())
+                    mask |= next | (prev << 4u);
+                if(kmer.rHash() <= kmer.fHash())
+                    mask |= (prev ? 1u << (seq[kmer.pos - 1] ^ 3u) : 0) |
+                            ((next ? 1u << (seq[kmer.pos + k] ^ 3u) : 0) << 4u);
+                buf.push_back({hash, mask});
+            }
+            if (!kmer.hasNext())
+                break;
+            kmer = kmer.next();
+        }
+        records.addAll(buf.begin(), buf.end());
+    };
+    processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, task);
+    return records.collect();
+}
+
+std::vector<hashing::htype>
+findJunctionsExact(logging::Logger &logger, const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
+                   size_t threads, size_t memory_limit) {
+    double start_time = omp_get_wtime();
+    std::vector<Sequence> split_disjointigs = splitDisjointigs(disjointigs, hasher.getK());
+    const size_t k = hasher.getK();
+    size_t total_kmers = 0;
+    for(const Sequence &seq : split_disjointigs)
+        total_kmers += seq.size() >= k ? seq.size() - k + 1 : 0;
+    size_t parts = 1;
+    if(memory_limit > 0)
+        parts = std::max<size_t>(1, (total_kmers * sizeof(KmerExtensions) + memory_limit - 1) / memory_limit);
+    logger.info() << "Counting extensions of " << total_kmers << " k-mers in " << parts << " partitions." << std::endl;
+    ParallelRecordCollector<hashing::htype> junctions(threads);
+    for(size_t part = 0; part < parts; part++) {
+        std::vector<KmerExtensions> sorted = collectKmerExtensions(logger, split_disjointigs, hasher, threads, part, parts);
+        __gnu_parallel::sort(sorted.begin(), sorted.end());
+//        Each thread reduces runs of equal k-mers that start inside its own chunk of the sorted array
+        std::vector<size_t> borders(threads + 1);
+        for(size_t i = 0; i <= threads; i++) {
+            size_t b = sorted.size() * i / threads;
+            while(b > 0 && b < sorted.size() && sorted[b].hash == sorted[b - 1].hash)
+                b++;
+            borders[i] = b;
+        }
+        omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(borders, sorted, junctions, threads) schedule(static, 1)
+        for(size_t i = 0; i < threads; i++) {
+            size_t j = borders[i];
+            while(j < borders[i + 1]) {
+                unsigned char mask = 0;
+                size_t end = j;
+                while(end < sorted.size() && sorted[end].hash == sorted[j].hash) {
+                    mask |= sorted[end].mask;
+                    end++;
+                }
+                if(__builtin_popcount(mask & 15u) != 1 || __builtin_popcount(mask >> 4u) != 1)
+                    junctions.emplace_back(sorted[j].hash);
+                j = end;
+            }
+        }
+    }
+    std::vector<hashing::htype> res = junctions.collect();
+    __gnu_parallel::sort(res.begin(), res.end());
+//    Pieces without junctions, e.g. isolated cycles, still need a vertex
+    ParallelRecordCollector<hashing::htype> extra(threads);
+    std::function<void(size_t, const Sequence &)> cycle_task = [&res, &hasher, &extra](size_t pos, const Sequence & seq) {
+        if(seq.size() < hasher.getK())
+            return;
+        KWH kmer(hasher, seq, 0);
+        while (true) {
+            if(std::binary_search(res.begin(), res.end(), kmer.hash()))
+                return;
+            if (!kmer.hasNext())
+                break;
+            kmer = kmer.next();
+        }
+        extra.emplace_back(KWH(hasher, seq, 0).hash());
+    };
+    processRecords(split_disjointigs.begin(), split_disjointigs.end(), logger, threads, cycle_task);
+    res.insert(res.end(), extra.begin(), extra.end());
+    __gnu_parallel::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    logger.info() << "Collected " << res.size() << " junctions." << std::endl;
+    logger.trace() << "Exact junction search took " << omp_get_wtime() - start_time << " seconds" << std::endl;
     return res;
 }
 
 SparseDBG constructDBG(logging::Logger &logger, const std::vector<hashing::htype> &vertices, const std::vector<Sequence> &disjointigs,
              const RollingHash &hasher, size_t threads) {
     logger.info() << "Starting DBG construction." << std::endl;
-    SparseDBG dbg(vertices.begin(), vertices.end(), hasher);
+    SparseDBG dbg(vertices, hasher, threads);
     logger.info() << "Vertices created." << std::endl;
+    logger.trace() << "Vertex index (" << hashIndexTypeName(SparseDBG::vertex_index_type) << ") uses " <<
+                   dbg.vertexIndexMemory() / 1024 / 1024 << "Mb for " << dbg.size() << " vertices" << std::endl;
     std::function<void(size_t, Sequence &)> edge_filling_task = [&dbg](size_t pos, Sequence & seq) {
         dbg.processRead(seq);
     };
     processRecords(disjointigs.begin(), disjointigs.end(), logger, threads, edge_filling_task);
+    dbg.publishStagedEdges(logger, threads);
 
     logger.info() << "Filled dbg edges. Adding hanging vertices " << std::endl;
     ParallelRecordCollector<std::pair<Vertex*, Edge *>> tips(threads);
 
-    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> task =
-            [&tips](size_t pos, std::pair<const hashing::htype, Vertex> & pair) {
+    std::function<void(size_t, std::pair<const hashing::htype, VertexPair> &)> task =
+            [&tips](size_t pos, std::pair<const hashing::htype, VertexPair> & pair) {
                 Vertex &rec = pair.second;
                 for (Edge &edge : rec) {
                     if(edge.end() == nullptr) {
@@ -160,7 +281,7 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
     if (disjointigs_file == "none") {
         std::function<void()> task = [&logger, &lib, &threads, &w, &dir, &hasher]() {
             std::vector<hashing::htype> hash_list;
-            hash_list = constructMinimizers(logger, lib, threads, hasher, w);
+            hash_list = constructMinimizers(logger, lib, threads, hasher, w, dir / "minimizer_buckets", minimizer_memory_limit);
             std::vector<Sequence> disjointigs = constructDisjointigs(hasher, w, lib, hash_list, threads, logger);
             hash_list.clear();
             std::ofstream df;
@@ -184,7 +305,10 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
     }
     std::vector<hashing::htype> vertices;
     if (vertices_file == "none") {
-        vertices = findJunctions(logger, disjointigs, hasher, threads);
+        if(exact_junctions)
+            vertices = findJunctionsExact(logger, disjointigs, hasher, threads, minimizer_memory_limit);
+        else
+            vertices = findJunctions(logger, disjointigs, hasher, threads);
         std::ofstream os;
         os.open(std::string(dir.c_str()) + "/vertices.save");
         writeHashs(os, vertices);
@@ -15,8 +15,15 @@
 #include "common/omp_utils.hpp"
 #include <wait.h>
 
+//If set, DBGPipeline selects junctions with findJunctionsExact instead of the bloom filter based findJunctions.
+inline bool exact_junctions = false;
+
 std::vector<hashing::htype> findJunctions(logging::Logger & logger, const std::vector<Sequence>& disjointigs,
                                  const hashing::RollingHash &hasher, size_t threads);
+//Finds junctions without false positives by sorting all k-mers of disjointigs with their extensions.
+//K-mers are processed in several passes if their records do not fit into memory_limit bytes. Zero limit means one pass.
+std::vector<hashing::htype> findJunctionsExact(logging::Logger & logger, const std::vector<Sequence>& disjointigs,
+                                 const hashing::RollingHash &hasher, size_t threads, size_t memory_limit = 0);
 dbg::SparseDBG constructDBG(logging::Logger & logger, const std::vector<hashing::htype> &vertices,
                        const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher, size_t threads);
 dbg::SparseDBG DBGPipeline(logging::Logger & logger, const hashing::RollingHash &hasher, size_t w, const io::Library &lib,
@@ -0,0 +1,48 @@
+#include "frozen_dbg.hpp"
+
+using namespace dbg;
+
+FrozenDBG::FrozenDBG(SparseDBG &dbg, size_t threads) {
+    vertices_.reserve(dbg.size() * 2);
+    for(auto &it : dbg) {
+        vertices_.emplace_back(&it.second);
+        vertices_.emplace_back(&it.second.rc());
+    }
+    VERIFY_MSG(vertices_.size() < none, "Too many vertices for 32-bit vertex ids");
+    ids_.reserve(dbg.size());
+    first_edge_.resize(vertices_.size() + 1);
+    for(size_t i = 0; i < vertices_.size(); i++) {
+        if(i % 2 == 0)
+            ids_.emplace(vertices_[i]->hash(), i);
+        first_edge_[i + 1] = first_edge_[i] + vertices_[i]->outDeg();
+    }
+    VERIFY_MSG(first_edge_.back() < none, "Too many edges for 32-bit edge ids");
+    edges_.resize(first_edge_.back());
+    edge_records_.resize(first_edge_.back());
+    outgoing_.resize(vertices_.size() * 4, none);
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(static, 1024)
+    for(size_t i = 0; i < vertices_.size(); i++) {
+        id_type e = first_edge_[i];
+        for(Edge &edge : *vertices_[i]) {
+            VERIFY(edge.size() < none);
+            edges_[e] = &edge;
+            edge_records_[e] = {id(*edge.end()), uint32_t(edge.size())};
+            outgoing_[(i << 2u) + edge.seq[0]] = e;
+            e++;
+        }
+    }
+}
+
+FrozenDBG::id_type FrozenDBG::id(const Vertex &vertex) const {
+    auto it = ids_.find(vertex.hash());
+    VERIFY_MSG(it != ids_.end(), "Vertex was added to the graph after FrozenDBG was built");
+    id_type res = vertex.isCanonical() ? it->second : rc(it->second);
+    VERIFY_MSG(vertices_[res] == &vertex, "Vertex does not belong to the graph of FrozenDBG");
+    return res;
+}
+
+FrozenDBG::id_type FrozenDBG::id(const Edge &edge) const {
+    const Vertex &start = *edge.start();
+    return first_edge_[id(start)] + (&edge - &*start.begin());
+}
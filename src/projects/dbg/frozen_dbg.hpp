@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sparse_dbg.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace dbg {
+//    Read-only index of a graph that is not modified anymore. Vertices and edges are numbered by 32-bit ids. This is an
+//    index of pointers into SparseDBG, not a compressed copy of the graph: sequences stay in the graph and only ids of
+//    edge ends, edge lengths and outgoing edge ids are stored in contiguous arrays. Outgoing edges of vertex v have ids
+//    from firstEdge(v) to firstEdge(v + 1) and edge starting with nucleotide c is found with one table lookup. Vertex
+//    with id v has reverse complement with id v ^ 1. Ids of vertices are kept in the index and not in the vertices, so
+//    several indices of one graph may exist at the same time.
+//    Index stays valid only while no vertices or edges are added to or removed from the graph.
+    class FrozenDBG {
+    public:
+        typedef uint32_t id_type;
+        static constexpr id_type none = id_type(-1);
+    private:
+//        End vertex and length are kept together so that walking along a path touches one record per edge
+        struct EdgeRecord {
+            id_type end;
+            uint32_t size;
+        };
+        std::vector<Vertex *> vertices_;
+        std::vector<Edge *> edges_;
+        std::vector<EdgeRecord> edge_records_;
+        std::vector<id_type> first_edge_;
+        std::vector<id_type> outgoing_;
+//        Id of canonical vertex by its hash
+        std::unordered_map<hashing::htype, id_type, hashing::alt_hasher<hashing::htype>> ids_;
+    public:
+        FrozenDBG(SparseDBG &dbg, size_t threads);
+        FrozenDBG(const FrozenDBG &) = delete;
+
+        size_t vertexCount() const {return vertices_.size();}
+        size_t edgeCount() const {return edges_.size();}
+        Vertex &vertex(id_type v) const {return *vertices_[v];}
+        Edge &edge(id_type e) const {return *edges_[e];}
+        id_type id(const Vertex &vertex) const;
+        id_type id(const Edge &edge) const;
+        id_type rc(id_type v) const {return v ^ 1u;}
+        id_type firstEdge(id_type v) const {return first_edge_[v];}
+        id_type end(id_type e) const {return edge_records_[e].end;}
+        size_t edgeSize(id_type e) const {return edge_records_[e].size;}
+        id_type outgoing(id_type v, unsigned char c) const {return outgoing_[(size_t(v) << 2u) + c];}
+        bool hasOutgoing(id_type v, unsigned char c) const {return outgoing(v, c) != none;}
+    };
+}
@@ -31,7 +31,7 @@ namespace dbg {
                                           const RollingHash &hasher, const std::vector<htype> &hash_list,
                                           const size_t w) {
         logger.info() << "Starting construction of sparse de Bruijn graph" << std::endl;
-        SparseDBG sdbg(hash_list.begin(), hash_list.end(), hasher);
+        SparseDBG sdbg(hash_list, hasher, threads);
         logger.info() << "Vertex map constructed." << std::endl;
         io::SeqReader reader(reads_file, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
         logger.info() << "Filling edge sequences." << std::endl;
@@ -42,14 +42,12 @@ namespace dbg {
 
     void tieTips(logging::Logger &logger, SparseDBG &sdbg, size_t w, size_t threads) {
         logger.info() << " Collecting tips " << std::endl;
-//    TODO reduce memory consumption!! A lot of duplicated k-mer storing
-        ParallelRecordCollector<std::pair<Vertex *, Sequence>> old_edges(threads);
         ParallelRecordCollector<Sequence> new_edges(threads);
         ParallelRecordCollector<htype> new_minimizers(threads);
-        std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg, &old_edges, &new_minimizers, &new_edges](size_t pos, std::pair<const htype, Vertex> &pair) {
+        std::function<void(size_t, std::pair<const htype, VertexPair> &)> task =
+                [&sdbg, &new_minimizers, &new_edges](size_t pos, std::pair<const htype, VertexPair> &pair) {
                     Vertex &cvertex = pair.second;
-                    for (auto *vit: {&cvertex, &cvertex.rc()}) {
+                    for (auto *vit: {static_cast<Vertex *>(&cvertex), &cvertex.rc()}) {
                         Vertex &vertex = *vit;
                         VERIFY(!vertex.seq.empty());
                         for (const Edge &ext: vertex) {
@@ -58,83 +56,87 @@ namespace dbg {
                                 KWH kwh(sdbg.hasher(), seq, ext.size());
                                 new_edges.add(seq);
                                 new_minimizers.emplace_back(kwh.hash());
-                            } else {
-                                old_edges.add({&vertex, ext.seq});
                             }
                         }
+                        vertex.removeOutgoingIf([](const Edge &edge) {return edge.end() == nullptr;});
                     }
-                    cvertex.clear();
                 };
         processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
         logger.info() << "Added " << new_minimizers.size() << " artificial minimizers from tips." << std::endl;
-        logger.info() << "Collected " << old_edges.size() << " old edges." << std::endl;
+        std::unordered_set<htype, alt_hasher<htype>> new_hashes;
         for (auto it = new_minimizers.begin(); it != new_minimizers.end(); ++it) {
             sdbg.addVertex(*it);
+            new_hashes.emplace(*it);
         }
         logger.info() << "New minimizers added to sparse graph." << std::endl;
-        logger.info() << "Refilling graph with old edges." << std::endl;
-        RefillSparseDBGEdges(sdbg, old_edges.begin(), old_edges.end(), logger, threads);
+//        Only edges that pass through new vertices have to be split. All other edges stay in place.
+        std::vector<Edge *> split_edges = sdbg.edgesThrough(new_hashes, logger, threads);
+        logger.info() << "Collected " << split_edges.size() << " old edges passing through new minimizers." << std::endl;
+        logger.info() << "Splitting old edges." << std::endl;
+        sdbg.splitEdges(split_edges, logger, threads);
         logger.info() << "Filling graph with new edges." << std::endl;
         FillSparseDBGEdges(sdbg, new_edges.begin(), new_edges.end(), logger, threads, sdbg.hasher().getK() + 1);
         logger.info() << "Finished fixing sparse de Bruijn graph." << std::endl;
     }
 
-    void UpdateVertexTips(Vertex &rec, ParallelRecordCollector<Vertex *> &queue) {
-        bool ok = true;
+    bool TipSizesKnown(const Vertex &rec) {
         for (const Edge &edge: rec) {
-            if (edge.getTipSize() == size_t(-1)) {
-                edge.updateTipSize();
-            }
-            if (edge.getTipSize() == size_t(-1)) {
-                ok = false;
-            }
+            if (edge.getTipSize() == size_t(-1))
+                return false;
         }
-        if (ok && rec.inDeg() == 1) {
-            queue.add(&(rec.rc()[0].end()->rc()));
+        return true;
+    }
+
+    size_t PropagateTipSizes(Vertex &rec) {
+        size_t resolved = 0;
+        Vertex *cur = &rec;
+        while (true) {
+            resolved++;
+            if (cur->inDeg() != 1)
+                break;
+            Edge &edge = cur->rc()[0].rc();
+            if (edge.getTipSize() != size_t(-1))
+                break;
+            size_t tip_size = 0;
+            for (const Edge &out: *cur) {
+                tip_size = std::max(tip_size, out.getTipSize());
+            }
+            Vertex &start = *edge.start();
+            start.lock();
+            edge.extraInfo = tip_size + edge.size();
+            bool known = TipSizesKnown(start);
+            start.unlock();
+            if (!known)
+                break;
+            cur = &start;
         }
+        return resolved;
     }
 
     void findTips(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.info() << " Finding tips " << std::endl;
-//    TODO reduce memory consumption!! A lot of duplicated k-mer storing
-        ParallelRecordCollector<Vertex *> queue(threads);
-#pragma omp parallel default(none) shared(sdbg, logger, queue)
-        {
-#pragma omp single
-            {
-                for (auto &it: sdbg) {
-                    Vertex &rec = it.second;
-                    VERIFY_OMP(!rec.seq.empty());
-#pragma omp task default(none) shared(sdbg, rec, logger, queue)
-                    {
-                        UpdateVertexTips(rec, queue);
-                        UpdateVertexTips(rec.rc(), queue);
+        double start_time = omp_get_wtime();
+//        Vertices that are resolved from the start are collected before propagation so that propagation never reaches
+//        a vertex that is also used as a starting point
+        ParallelRecordCollector<Vertex *> seeds(threads);
+        std::function<void(size_t, std::pair<const htype, VertexPair> &)> task =
+                [&seeds](size_t pos, std::pair<const htype, VertexPair> &pair) {
+                    for (Vertex *rec: {static_cast<Vertex *>(&pair.second), &pair.second.rc()}) {
+                        VERIFY_OMP(!rec->seq.empty());
+                        if (TipSizesKnown(*rec))
+                            seeds.add(rec);
                     }
-                }
-            }
-        }
-        logger.info() << "Found initial tips. Looking for iterative tips" << std::endl;
-        size_t cnt = 0;
-        while (!queue.empty()) {
-            logger.info() << "Iteration " << cnt << ". Queue size " << queue.size() << std::endl;
-            std::vector<Vertex *> prev_queue = queue.collectUnique();
-            queue.clear();
-#pragma omp parallel default(none) shared(sdbg, logger, prev_queue, queue)
-            {
-#pragma omp single
-                {
-                    for (auto &it: prev_queue) {
-                        Vertex &rec = *it;
-                        VERIFY_OMP(!rec.seq.empty());
-#pragma omp task default(none) shared(sdbg, rec, logger, queue)
-                        {
-                            UpdateVertexTips(rec, queue);
-                        }
-                    }
-                }
-            }
-        }
-        logger.info() << "Tip finding finished" << std::endl;
+                };
+        processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
+        std::vector<Vertex *> starts = seeds.collect();
+        logger.info() << "Found " << starts.size() << " initial tips. Propagating tip sizes" << std::endl;
+        ParallelCounter resolved(threads);
+        std::function<void(size_t, Vertex *&)> propagate_task = [&resolved](size_t pos, Vertex *&rec) {
+            resolved += PropagateTipSizes(*rec);
+        };
+        processObjects(starts.begin(), starts.end(), logger, threads, propagate_task);
+        logger.info() << "Tip finding finished. Resolved " << resolved.get() << " vertices" << std::endl;
+        logger.trace() << "Tip finding took " << omp_get_wtime() - start_time << " seconds" << std::endl;
     }
 
     void mergeLoop(Path path) {
@@ -161,6 +163,10 @@ namespace dbg {
 
     void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge) {
         Path path = Path::WalkForward(edge);
+        MergePath(start, path);
+    }
+
+    void MergePath(Vertex &start, Path &path) {
         Vertex &end = path.finish().rc();
         if (path.size() > 1 && end.hash() >= start.hash()) {
             VERIFY(start.seq.size() > 0)
@@ -187,8 +193,8 @@ namespace dbg {
 
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.trace() << "Merging linear unbranching paths" << std::endl;
-        std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg](size_t pos, std::pair<const htype, Vertex> &pair) {
+        std::function<void(size_t, std::pair<const htype, VertexPair> &)> task =
+                [&sdbg](size_t pos, std::pair<const htype, VertexPair> &pair) {
                     Vertex &start = pair.second;
                     if (!start.isJunction())
                         return;
@@ -210,8 +216,8 @@ namespace dbg {
     void mergeCyclicPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.trace() << "Merging cyclic paths" << std::endl;
         ParallelRecordCollector<htype> loops(threads);
-        std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg, &loops](size_t pos, std::pair<const htype, Vertex> &pair) {
+        std::function<void(size_t, std::pair<const htype, VertexPair> &)> task =
+                [&sdbg, &loops](size_t pos, std::pair<const htype, VertexPair> &pair) {
                     Vertex &start = pair.second;
                     if (start.isJunction() || start.marked()) {
                         return;
@@ -228,30 +234,122 @@ namespace dbg {
                     if (ismin) {
                         loops.emplace_back(start.hash());
                     }
-                    start.unlock();
                 };
         processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
         logger.trace() << "Found " << loops.size() << " perfect loops" << std::endl;
-        for (htype loop: loops) {
+//        Each loop is claimed by its vertex with minimal hash and loops are vertex disjoint,
+//        so loops are merged in parallel after all of them are found.
+        std::vector<htype> loop_starts = loops.collect();
+        std::function<void(size_t, htype &)> merge_task = [&sdbg](size_t pos, htype &loop) {
             Vertex &start = sdbg.getVertex(loop);
             Path path = Path::WalkForward(start[0]);
             mergeLoop(path);
-        }
+        };
+        processObjects(loop_starts.begin(), loop_starts.end(), logger, threads, merge_task);
         logger.trace() << "Finished merging cyclic paths" << std::endl;
     }
 
     void mergeAll(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.trace() << "Merging unbranching paths" << std::endl;
+        double start_time = omp_get_wtime();
         mergeLinearPaths(logger, sdbg, threads);
+        logger.trace() << "Merging linear paths took " << omp_get_wtime() - start_time << " seconds" << std::endl;
 //    sdbg.checkConsistency(threads, logger);
+        start_time = omp_get_wtime();
         mergeCyclicPaths(logger, sdbg, threads);
+        logger.trace() << "Merging cyclic paths took " << omp_get_wtime() - start_time << " seconds" << std::endl;
 //    sdbg.checkConsistency(threads, logger);
         logger.trace() << "Removing isolated vertices" << std::endl;
-        sdbg.removeMarked();
+        start_time = omp_get_wtime();
+        size_t removed = sdbg.removeMarked(threads);
+        logger.trace() << "Removed " << removed << " vertices in " << omp_get_wtime() - start_time << " seconds" << std::endl;
         logger.trace() << "Finished removing isolated vertices" << std::endl;
         logger.trace() << "Finished merging unbranching paths" << std::endl;
     }
 
+    std::vector<Vertex *> insertSequences(logging::Logger &logger, SparseDBG &sdbg, const std::vector<Sequence> &new_seqs,
+                                          size_t w, size_t threads,
+                                          const std::function<void(const std::vector<Edge *> &)> &before_split) {
+        logger.trace() << "Inserting " << new_seqs.size() << " new sequences into the graph" << std::endl;
+        double start_time = omp_get_wtime();
+        std::unordered_set<htype, alt_hasher<htype>> new_hashes;
+        for (const Sequence &seq: new_seqs) {
+            for (KWH kwh(sdbg.hasher(), seq, 0);; kwh = kwh.next()) {
+                if (!sdbg.containsVertex(kwh.hash())) {
+                    sdbg.addVertex(kwh);
+                    new_hashes.emplace(kwh.hash());
+                }
+                if (!kwh.hasNext())
+                    break;
+            }
+        }
+        std::vector<Edge *> split_edges = sdbg.edgesThrough(new_hashes, logger, threads);
+        logger.trace() << "Found " << split_edges.size() << " edges passing through new k-mers" << std::endl;
+        std::unordered_set<htype, alt_hasher<htype>> changed;
+        for (Edge *edge: split_edges) {
+            changed.emplace(edge->start()->hash());
+        }
+        before_split(split_edges);
+        sdbg.splitEdges(split_edges, logger, threads);
+        std::function<void(size_t, const Sequence &)> task = [&sdbg](size_t num, const Sequence &seq) {
+            sdbg.processRead(seq);
+        };
+        ParallelProcessor<const Sequence>(task, logger, threads).processObjects(new_seqs.begin(), new_seqs.end(), 1024);
+        sdbg.publishStagedEdges(logger, threads);
+//        Most new vertices are not junctions. Paths through them are merged from vertices at their ends. Old vertices
+//        are never merged so that paths of reads that do not go through split edges stay valid.
+        std::function<bool(const Vertex &)> mergeable = [&new_hashes](const Vertex &vertex) {
+            return !vertex.isJunction() && new_hashes.find(vertex.hash()) != new_hashes.end();
+        };
+        std::vector<Vertex *> starts;
+        for (htype hash: new_hashes) {
+            for (Vertex *vertex: sdbg.getVertices(hash)) {
+                if (!mergeable(*vertex))
+                    continue;
+                for (Edge &edge: *vertex) {
+                    if (!mergeable(*edge.end()))
+                        starts.emplace_back(&edge.end()->rc());
+                }
+            }
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+        for (Vertex *start: starts) {
+            changed.emplace(start->hash());
+            for (Edge &edge: *start) {
+                Path path(*start);
+                path += edge;
+                for (Vertex *next = edge.end(); next != start && mergeable(*next); next = (*next)[0].end()) {
+                    path += (*next)[0];
+                }
+                MergePath(*start, path);
+            }
+        }
+        size_t removed = sdbg.removeMarked(threads);
+        std::vector<Vertex *> res;
+        for (const Sequence &seq: new_seqs) {
+            for (const KWH &kwh: sdbg.extractVertexPositions(seq)) {
+                changed.emplace(kwh.hash());
+                if (new_hashes.find(kwh.hash()) != new_hashes.end()) {
+                    new_hashes.erase(kwh.hash());
+                    for (Vertex *vertex: sdbg.getVertices(kwh.hash()))
+                        res.emplace_back(vertex);
+                }
+            }
+        }
+        std::vector<Vertex *> changed_vertices;
+        for (htype hash: changed) {
+            if (sdbg.containsVertex(hash)) {
+                for (Vertex *vertex: sdbg.getVertices(hash))
+                    changed_vertices.emplace_back(vertex);
+            }
+        }
+        sdbg.updateAnchors(changed_vertices, w, logger, threads);
+        logger.trace() << "Inserted sequences with " << res.size() / 2 << " new vertices, " << removed <<
+                       " temporary vertices were merged. Insertion took " << omp_get_wtime() - start_time << " seconds" << std::endl;
+        return std::move(res);
+    }
+
     void CalculateCoverage(const std::experimental::filesystem::path &dir, const RollingHash &hasher, const size_t w,
                            const io::Library &lib, size_t threads, logging::Logger &logger, SparseDBG &dbg) {
         logger.info() << "Calculating edge coverage." << std::endl;
@@ -260,7 +358,7 @@ namespace dbg {
         std::ofstream os;
         os.open(dir / "coverages.save");
         os << dbg.size() << std::endl;
-        for (std::pair<const htype, Vertex> &pair: dbg) {
+        for (std::pair<const htype, VertexPair> &pair: dbg) {
             Vertex &v = pair.second;
             os << v.hash() << " " << v.outDeg() << " " << v.inDeg() << std::endl;
             for (const Edge &edge: v) {
@@ -329,7 +427,7 @@ namespace dbg {
             sequences.add(seq);
         };
         processRecords(reader.begin(), reader.end(), logger, threads, collect_task);
-        SparseDBG res(vertices.begin(), vertices.end(), hasher);
+        SparseDBG res(vertices.collectUnique(), hasher, threads);
         reader.reset();
         FillSparseDBGEdges(res, sequences.begin(), sequences.end(), logger, threads, hasher.getK() + 1);
         logger.info() << "Finished loading graph" << std::endl;
@@ -14,17 +14,7 @@ namespace dbg {
                 sdbg.processRead(seq);
         };
         processRecords(begin, end, logger, threads, task);
-        logger.trace() << "Sparse graph edges filled." << std::endl;
-    }
-
-    template<class Iterator>
-    void RefillSparseDBGEdges(SparseDBG &sdbg, Iterator begin, Iterator end, logging::Logger &logger, size_t threads) {
-        logger.trace() << "Starting to fill edges" << std::endl;
-        std::function<void(size_t, std::pair<Vertex *, Sequence> &)> task = [&sdbg](size_t pos,
-                                                                                    std::pair<Vertex *, Sequence> &contig) {
-            sdbg.processEdge(*contig.first, contig.second);
-        };
-        processObjects(begin, end, logger, threads, task);
+        sdbg.publishStagedEdges(logger, threads);
         logger.trace() << "Sparse graph edges filled." << std::endl;
     }
 
@@ -41,12 +31,21 @@ namespace dbg {
 
     void tieTips(logging::Logger &logger, SparseDBG &sdbg, size_t w, size_t threads);
 
-    void UpdateVertexTips(Vertex &rec, ParallelRecordCollector<Vertex *> &queue);
+    bool TipSizesKnown(const Vertex &rec);
+
+//    Called for a vertex once tip sizes of all its outgoing edges are known. Sets tip size of its only incoming edge and
+//    continues to the start of that edge if it was the last unknown outgoing edge there. The check is done under the
+//    start vertex lock, so every vertex is resolved by exactly one thread and no rounds or queues are needed.
+//    Returns the number of resolved vertices.
+    size_t PropagateTipSizes(Vertex &rec);
 
     void findTips(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
     void mergeLoop(Path path);
 
+//    Replaces unbranching path with a single edge. Path should start and end at vertices that are kept in the graph.
+    void MergePath(Vertex &start, Path &path);
+
     void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge);
 
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
@@ -55,6 +54,13 @@ namespace dbg {
 
     void mergeAll(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
+//    Inserts new sequences into the graph in place. Only edges that share k-mers with new sequences are split, unbranching
+//    paths through new vertices are merged and anchors of changed edges are updated with step w. before_split is called
+//    with split edges in both orientations while they are still valid. Returns new vertices that remain in the graph.
+    std::vector<Vertex *> insertSequences(logging::Logger &logger, SparseDBG &sdbg, const std::vector<Sequence> &new_seqs,
+                                          size_t w, size_t threads,
+                                          const std::function<void(const std::vector<Edge *> &)> &before_split);
+
     void CalculateCoverage(const std::experimental::filesystem::path &dir, const hashing::RollingHash &hasher,
                            const size_t w,
                            const io::Library &lib, size_t threads, logging::Logger &logger, SparseDBG &dbg);
@@ -17,36 +17,77 @@ void AlignedRead::invalidate() {
     path = {};
 }
 
+VertexRecord::Position VertexRecord::find(const Sequence &seq) const {
+    Position pos = {0, 0};
+    size_t i = 0;
+    while(i < seq.size()) {
+        if(pos.offset == nodes[pos.node].label.size()) {
+            pos.node = nodes[pos.node].next[seq[i]];
+            pos.offset = 0;
+            if(pos.node == 0)
+                return {size_t(-1), 0};
+        }
+        const Sequence &label = nodes[pos.node].label;
+        size_t len = std::min(label.size() - pos.offset, seq.size() - i);
+        if(label.matchLength(seq, pos.offset, i, len) < len)
+            return {size_t(-1), 0};
+        pos.offset += len;
+        i += len;
+    }
+    return pos;
+}
+
+void VertexRecord::insert(const Sequence &seq, size_t cnt) {
+    size_t node = 0;
+    nodes[0].total += cnt;
+    size_t i = 0;
+    while(i < seq.size()) {
+        unsigned char c = seq[i];
+        size_t child = nodes[node].next[c];
+        if(child == 0) {
+            child = nodes.size();
+            nodes.emplace_back();
+            nodes[child].label = seq.Subseq(i);
+            nodes[node].next[c] = child;
+            node = child;
+            nodes[node].total += cnt;
+            break;
+        }
+        const Sequence &label = nodes[child].label;
+        size_t len = std::min(label.size(), seq.size() - i);
+        size_t match = label.matchLength(seq, 0, i, len);
+        if(match < label.size()) {
+//            Path leaves the label in the middle, so the label is split and its suffix goes to a new node
+            size_t rest = nodes.size();
+            nodes.emplace_back(nodes[child]);
+            nodes[rest].label = nodes[child].label.Subseq(match);
+            nodes[child].label = nodes[child].label.Subseq(0, match);
+            std::fill(nodes[child].next, nodes[child].next + 4, 0);
+            nodes[child].next[nodes[rest].label[0]] = rest;
+            nodes[child].ends = 0;
+            if(nodes[rest].total == 0)
+                dead_cnt += 1;
+        }
+        if(nodes[child].total == 0)
+            dead_cnt -= 1;
+        node = child;
+        nodes[node].total += cnt;
+        i += match;
+    }
+    nodes[node].ends += cnt;
+}
+
 void VertexRecord::addPath(const Sequence &seq) {
     lock();
     cov += 1;
-    for(std::pair<Sequence, size_t> &path : paths) {
-        if(path.first == seq) {
-            path.second += 1;
-            if(path.second == 1)
-                zero_cnt -= 1;
-            unlock();
-            return;
-        }
-    }
-    paths.emplace_back(seq, 1);
+    insert(seq, 1);
     unlock();
 }
 
 void VertexRecord::removePath(const Sequence &seq) {
     lock();
-    bool found = false;
-    for(std::pair<Sequence, size_t> &path : paths) {
-        if(path.first == seq) {
-            found = true;
-            VERIFY(path.second > 0);
-            path.second -= 1;
-            cov -= 1;
-            if(path.second == 0)
-                zero_cnt += 1;
-            break;
-        }
-    }
+    Position pos = find(seq);
+    bool found = pos.valid() && pos.offset == nodes[pos.node].label.size() && nodes[pos.node].ends > 0;
     if(!found) {
         std::cout << "Error" << std::endl;
         unlock();
@@ -54,88 +95,138 @@ void VertexRecord::removePath(const Sequence &seq) {
         std::cout << this->str() << std::endl;
     }
     VERIFY(found);
-    if(zero_cnt > paths.size() / 3) {
-        std::vector<std::pair<Sequence, size_t>> new_paths;
-        for(std::pair<Sequence, size_t> &rec : paths) {
-            if(rec.second != 0) {
-                new_paths.emplace_back(std::move(rec.first), rec.second);
+    cov -= 1;
+    size_t node = 0;
+    nodes[0].total -= 1;
+    for(size_t i = 0; i < seq.size(); i += nodes[node].label.size()) {
+        node = nodes[node].next[seq[i]];
+        nodes[node].total -= 1;
+        if(nodes[node].total == 0)
+            dead_cnt += 1;
+    }
+    nodes[node].ends -= 1;
+    if(dead_cnt > nodes.size() / 3)
+        compress();
+    unlock();
+}
+
+//Rebuilds the tree from paths that are still stored
+void VertexRecord::compress() {
+    std::vector<std::pair<Sequence, size_t>> stored = paths();
+    nodes.assign(1, Node());
+    dead_cnt = 0;
+    for(std::pair<Sequence, size_t> &path : stored)
+        insert(path.first, path.second);
+}
+
+void VertexRecord::traverse(bool unpack, const std::function<bool(size_t, size_t, const std::vector<unsigned char> &,
+                                                                  const Vertex *, size_t)> &visit) const {
+    struct Entry {
+        size_t node;
+        size_t depth;
+        const Vertex *vertex;
+        size_t len;
+    };
+    std::vector<unsigned char> prefix;
+    std::vector<Entry> stack = {{0, 0, unpack ? &v : nullptr, 0}};
+    while(!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[entry.node];
+        prefix.resize(entry.depth);
+        bool extend = true;
+        if(node.label.empty())
+            extend = visit(node.total, node.ends, prefix, entry.vertex, entry.len);
+        for(size_t i = 0; extend && i < node.label.size(); i++) {
+            unsigned char c = node.label[i];
+            prefix.push_back(c);
+            if(unpack) {
+                const Edge &edge = entry.vertex->getOutgoing(c);
+                entry.vertex = edge.end();
+                entry.len += edge.size();
             }
+            extend = visit(node.total, i + 1 == node.label.size() ? node.ends : 0, prefix, entry.vertex, entry.len);
+        }
+        if(!extend)
+            continue;
+        for(size_t c = 4; c > 0; c--) {
+            size_t child = node.next[c - 1];
+            if(child != 0 && nodes[child].total > 0)
+                stack.push_back({child, prefix.size(), entry.vertex, entry.len});
         }
-        std::swap(paths, new_paths);
-        zero_cnt = 0;
     }
-    unlock();
 }
 
 bool VertexRecord::isDisconnected(const Edge &edge) const {
     if(edge.end()->outDeg() == 0)
         return false;
-    for(const std::pair<Sequence, size_t> &rec : paths) { // NOLINT(readability-use-anyofallof)
-        if(rec.second > 0 && rec.first[0] == edge.seq[0] && rec.first.size() > 1)
-            return false;
-    }
-    return true;
+    size_t child = nodes[0].next[edge.seq[0]];
+    if(child == 0)
+        return true;
+    size_t single = nodes[child].label.size() == 1 ? nodes[child].ends : 0;
+    return nodes[child].total == single;
 }
 
 size_t VertexRecord::countStartsWith(const Sequence &seq) const {
-//        lock();
-    size_t cnt = 0;
-    for(const std::pair<Sequence, size_t> &rec : paths) {
-        if(rec.first.startsWith(seq)) {
-            cnt += rec.second;
-        }
-    }
-//        unlock();
-    return cnt;
+    Position pos = find(seq);
+    return pos.valid() ? nodes[pos.node].total : 0;
 }
 
 std::vector<GraphAlignment> VertexRecord::getBulgeAlternatives(const Vertex &end, double threshold) const {
-//        lock();
+//    Number of paths that pass through a prefix is known in the tree, so each prefix ending in end is a candidate
     std::vector<std::pair<Sequence, size_t>> candidates;
-    for(const auto & extension : paths) {
-        Path unpacked = CompactPath(v, extension.first).getPath();
-        for(size_t i = 1; i <= unpacked.size(); i++) {
-            if(end == unpacked.getVertex(i)){
-                candidates.emplace_back(extension.first.Subseq(0, i), extension.second);
-            }
-        }
-    }
-//        unlock();
-    if(candidates.empty())
-        return {};
+    traverse(true, [&end, &candidates](size_t total, size_t, const std::vector<unsigned char> &prefix, const Vertex *vertex, size_t) {
+        if(!prefix.empty() && *vertex == end)
+            candidates.emplace_back(Sequence(prefix), total);
+        return true;
+    });
     std::sort(candidates.begin(), candidates.end());
     std::vector<GraphAlignment> res;
-    size_t cnt = 0;
-    for(size_t i = 0; i < candidates.size(); i++) {
-        if(i > 0 && candidates[i-1].first != candidates[i].first) {
-            if(cnt >= threshold)
-                res.emplace_back(CompactPath(v, candidates[i - 1].first).getAlignment());
-            cnt = 0;
-        }
-        cnt += candidates[i].second;
+    for(std::pair<Sequence, size_t> &candidate : candidates) {
+        if(candidate.second >= threshold)
+            res.emplace_back(CompactPath(v, candidate.first).getAlignment());
     }
-    if(cnt >= threshold)
-        res.emplace_back(CompactPath(v, candidates.back().first).getAlignment());
     return std::move(res);
 }
 
 CompactPath VertexRecord::getFullUniqueExtension(const Sequence &start, size_t min_good_cov, size_t max_bad_cov) const {
-    Sequence res = start;
+    SequenceBuilder sb;
+    sb.append(start);
+    Position pos = find(start);
     while(true) {
-        unsigned char next = getUniqueExtension(res, min_good_cov, max_bad_cov);
+        unsigned char next = uniqueExtension(pos, min_good_cov, max_bad_cov);
         if(next == (unsigned char)-1)
             break;
-        std::vector<unsigned char> ext = {next};
-        res = res + Sequence(ext);
+        sb.append(char(next));
+        if(!pos.valid())
+            continue;
+        if(pos.offset < nodes[pos.node].label.size()) {
+            pos.offset += 1;
+        } else {
+            pos.node = nodes[pos.node].next[next];
+            pos.offset = 1;
+            if(pos.node == 0)
+                pos.node = size_t(-1);
+        }
     }
-    return {v, res};
+    return {v, sb.BuildSequence()};
 }
 
 unsigned char VertexRecord::getUniqueExtension(const Sequence &start, size_t min_good, size_t max_bad) const {
+    return uniqueExtension(find(start), min_good, max_bad);
+}
+
+unsigned char VertexRecord::uniqueExtension(const Position &pos, size_t min_good, size_t max_bad) const {
     std::vector<size_t> counts(4);
-    for(const auto & extension : paths) {
-        if(extension.first.size() > start.size() && extension.first.startsWith(start)) {
-            counts[extension.first[start.size()]] += extension.second;
+    if(pos.valid()) {
+        const Node &node = nodes[pos.node];
+        if(pos.offset < node.label.size()) {
+            counts[node.label[pos.offset]] = node.total;
+        } else {
+            for(size_t c = 0; c < 4; c++) {
+                if(node.next[c] != 0)
+                    counts[c] = nodes[node.next[c]].total;
+            }
         }
     }
     size_t bad = 0;
@@ -156,44 +247,40 @@ unsigned char VertexRecord::getUniqueExtension(const Sequence &start, size_t min
 
 std::vector<GraphAlignment> VertexRecord::getTipAlternatives(size_t len, double threshold) const {
     len += std::max<size_t>(30, len / 20);
-//        lock();
+//    All paths that pass through the shortest prefix of length at least len are cut to the same alignment
     std::vector<std::pair<Sequence, size_t>> candidates;
-    for(const auto & extension : paths) {
-        GraphAlignment unpacked = CompactPath(v, extension.first).getAlignment();
-        if(unpacked.len() >= len) {
-            unpacked.cutBack(unpacked.len() - len);
-            candidates.emplace_back(CompactPath(unpacked).cpath(), extension.second);
-        }
-    }
-//        unlock();
-    if(candidates.empty())
-        return {};
+    traverse(true, [len, &candidates](size_t total, size_t, const std::vector<unsigned char> &prefix, const Vertex *, size_t plen) {
+        if(plen < len)
+            return true;
+        candidates.emplace_back(Sequence(prefix), total);
+        return false;
+    });
     std::sort(candidates.begin(), candidates.end());
     std::vector<GraphAlignment> res;
-    size_t cnt = 0;
-    for(size_t i = 0; i < candidates.size(); i++) {
-        if(i > 0 && candidates[i - 1].first != candidates[i].first) {
-            if(cnt >= threshold) {
-                GraphAlignment cp = CompactPath(v, candidates[i - 1].first).getAlignment();
-                cp.cutBack(cp.len() - len);
-                res.emplace_back(cp);
-            }
-            cnt = 0;
+    for(std::pair<Sequence, size_t> &candidate : candidates) {
+        if(candidate.second >= threshold) {
+            GraphAlignment cp = CompactPath(v, candidate.first).getAlignment();
+            cp.cutBack(cp.len() - len);
+            res.emplace_back(cp);
         }
-        cnt += candidates[i].second;
-    }
-    if(cnt >= threshold) {
-        GraphAlignment cp = CompactPath(v, candidates.back().first).getAlignment();
-        cp.cutBack(cp.len() - len);
-        res.emplace_back(cp);
     }
     return std::move(res);
 }
 
+std::vector<std::pair<Sequence, size_t>> VertexRecord::paths() const {
+    std::vector<std::pair<Sequence, size_t>> res;
+    traverse(false, [&res](size_t, size_t ends, const std::vector<unsigned char> &prefix, const Vertex *, size_t) {
+        if(ends > 0)
+            res.emplace_back(Sequence(prefix), ends);
+        return true;
+    });
+    return std::move(res);
+}
+
 std::string VertexRecord::str() const {
     std::stringstream ss;
     lock();
-    for(const auto & path : paths) {
+    for(const auto & path : paths()) {
         ss << path.first << " " << path.second << std::endl;
     }
     unlock();
@@ -310,7 +397,7 @@ std::function<std::string(Edge &)> RecordStorage::labeler() const {
         return [this](Edge &edge) {
             const VertexRecord &rec = getRecord(*edge.start());
             std::stringstream ss;
-            for (const auto &ext : rec) {
+            for (const auto &ext : rec.paths()) {
                 if (ext.first[0] == edge.seq[0])
                     ss << ext.first << "(" << ext.second << ")\\n";
             }
@@ -379,6 +466,12 @@ void RecordStorage::invalidateSubreads(logging::Logger &logger, size_t threads)
     logger.info() << "Uncorrected reads were removed." << std::endl;
 }
 
+void RecordStorage::addVertices(const std::vector<dbg::Vertex *> &vertices) {
+    for(Vertex *v : vertices) {
+        data.emplace(v, VertexRecord(*v));
+    }
+}
+
 void RecordStorage::addSubpath(const CompactPath &cpath) {
     if(!cpath.valid())
         return;
@@ -395,6 +488,49 @@ void RecordStorage::addSubpath(const CompactPath &cpath) {
     processPath(cpath, vertex_task, edge_task);
 }
 
+void RecordStorage::collectSubpath(const CompactPath &cpath, ExtensionShards &extensions) {
+    if(!cpath.valid())
+        return;
+    std::function<void(Vertex &, const Sequence &)> vertex_task = [](Vertex &v, const Sequence &s) {};
+    if(track_suffixes)
+        vertex_task = [&extensions](Vertex &v, const Sequence &s) {
+            extensions[size_t(v.hash()) % extension_shards].emplace_back(&v, s);
+        };
+    std::function<void(Segment<Edge>)> edge_task = [](Segment<Edge> seg){};
+    if(track_cov)
+        edge_task = [](Segment<Edge> seg){
+            seg.contig().incCov(seg.size());
+        };
+    processPath(cpath, vertex_task, edge_task);
+}
+
+void RecordStorage::addExtensions(size_t threads, std::vector<ExtensionShards> &extensions) {
+//    Every shard is moved into the buffer of the first thread and sorted in place. Records of a vertex belong to one
+//    shard, so they are filled by one thread. Equal extensions are adjacent and are inserted once with their count.
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(dynamic, 1) shared(extensions)
+    for(size_t shard = 0; shard < extension_shards; shard++) {
+        std::vector<std::pair<Vertex *, Sequence>> &group = extensions[0][shard];
+        for(size_t t = 1; t < extensions.size(); t++) {
+            std::vector<std::pair<Vertex *, Sequence>> &other = extensions[t][shard];
+            std::move(other.begin(), other.end(), std::back_inserter(group));
+            other.clear();
+        }
+        std::sort(group.begin(), group.end());
+        size_t i = 0;
+        while(i < group.size()) {
+            VertexRecord &rec = data.find(group[i].first)->second;
+            size_t j = i + 1;
+            while(j < group.size() && group[j] == group[i])
+                j++;
+            rec.cov += j - i;
+            rec.insert(group[i].second, j - i);
+            i = j;
+        }
+        group.clear();
+    }
+}
+
 void RecordStorage::removeSubpath(const CompactPath &cpath) {
     if(!cpath.valid())
         return;
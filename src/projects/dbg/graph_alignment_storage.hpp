@@ -37,34 +37,62 @@ inline std::ostream& operator<<(std::ostream  &os, const AlignedRead &alignedRea
 }
 
 class RecordStorage;
+class VertexRecordTest;
 struct VertexRecord {
     friend RecordStorage;
+    friend VertexRecordTest;
 private:
-    typedef std::vector<std::pair<Sequence, size_t>> Storage;
-    typedef Storage::const_iterator const_iterator;
+//    Radix tree of path extensions that start at the vertex. Node 0 is the root that corresponds to empty extension and
+//    child index 0 means that there is no child. Label of a node holds nucleotides on the way from its parent and shares
+//    memory with the inserted path. Each node stores the number of paths that end in it and the number of paths that pass
+//    through it, so prefix queries take time proportional to the length of the prefix.
+    struct Node {
+        Sequence label;
+        uint32_t next[4] = {0, 0, 0, 0};
+        uint32_t ends = 0;
+        uint32_t total = 0;
+    };
+//    Place in the tree: node and the number of nucleotides of its label on the way to this place
+    struct Position {
+        size_t node;
+        size_t offset;
+        bool valid() const {return node != size_t(-1);}
+    };
     dbg::Vertex &v;
-    Storage paths;
-    size_t zero_cnt = 0;
+    std::vector<Node> nodes;
+    size_t dead_cnt = 0;
     size_t cov = 0;
 
     void lock() const {v.lock();}
     void unlock() const {v.unlock();}
 
+    Position find(const Sequence &seq) const;
+    unsigned char uniqueExtension(const Position &pos, size_t min_good, size_t max_bad) const;
+    void insert(const Sequence &seq, size_t cnt);
+    void compress();
+//    Visits prefixes of stored paths in depth first order. visit receives the number of paths that pass through the prefix
+//    and end in it, nucleotides of the prefix and, if unpack is set, the vertex where the prefix ends and total length
+//    of its edges. visit returns false if extensions of the prefix should be skipped.
+    void traverse(bool unpack, const std::function<bool(size_t, size_t, const std::vector<unsigned char> &,
+                                                         const dbg::Vertex *, size_t)> &visit) const;
+
     void addPath(const Sequence &seq);
     void removePath(const Sequence &seq);
-    void clear() {paths.clear();}
+    void clear() {nodes.assign(1, Node()); dead_cnt = 0;}
 public:
-    explicit VertexRecord(dbg::Vertex &_v) : v(_v) {}
+    explicit VertexRecord(dbg::Vertex &_v) : v(_v), nodes(1) {}
     VertexRecord(const VertexRecord &) = delete;
-    VertexRecord(VertexRecord &&other)  noexcept : v(other.v), paths(std::move(other.paths)),
-                                                   zero_cnt(other.zero_cnt), cov(other.cov) {}
+    VertexRecord(VertexRecord &&other)  noexcept : v(other.v), nodes(std::move(other.nodes)),
+                                                   dead_cnt(other.dead_cnt), cov(other.cov) {}
 
     VertexRecord & operator=(const VertexRecord &) = delete;
 
     size_t coverage() const {return cov;}
+//    Memory used by tree nodes. Labels share memory with stored read paths and are not counted.
+    size_t memoryUsage() const {return nodes.capacity() * sizeof(Node);}
     std::string str() const;
-    const_iterator begin() const {return paths.begin();}
-    const_iterator end() const {return paths.end();}
+//    Stored path extensions with their multiplicities
+    std::vector<std::pair<Sequence, size_t>> paths() const;
 
     size_t countStartsWith(const Sequence &seq) const;
 
@@ -126,6 +154,8 @@ class RecordStorage {
 private:
     std::vector<AlignedRead> reads;
     std::unordered_map<const dbg::Vertex *, VertexRecord> data;
+//    Paths of reads aligned by fill are packed into blocks of the arena and stay valid while the storage exists
+    SequenceArena arena;
     ReadLogger *readLogger;
 public:
     size_t min_len;
@@ -137,6 +167,15 @@ public:
 private:
     void processPath(const dbg::CompactPath &cpath, const std::function<void(dbg::Vertex &, const Sequence &)> &task,
                             const std::function<void(Segment<dbg::Edge>)> &edge_task = [](Segment<dbg::Edge>){}) const;
+//    Path extensions collected by one thread. They are split into shards by vertex hash, so that every shard can be
+//    grouped by vertex and added to vertex records independently of other shards.
+    typedef std::vector<std::vector<std::pair<dbg::Vertex *, Sequence>>> ExtensionShards;
+    static const size_t extension_shards = 256;
+    static const size_t fill_batch_length = size_t(1) << 26u;
+//    Same as addSubpath but extensions are saved to the buffer of the thread instead of vertex records
+    void collectSubpath(const dbg::CompactPath &cpath, ExtensionShards &extensions);
+//    Adds extensions collected by all threads to vertex records without taking vertex locks and clears the buffers
+    void addExtensions(size_t threads, std::vector<ExtensionShards> &extensions);
 public:
     RecordStorage(dbg::SparseDBG &dbg, size_t _min_len, size_t _max_len, size_t threads,
                   ReadLogger &readLogger, bool _track_cov = false, bool log_changes = false, bool track_suffixes = true);
@@ -164,6 +203,8 @@ public:
 
     std::function<std::string(dbg::Edge &)> labeler() const;
 
+//    Creates empty records for vertices that were added to the graph after the storage
+    void addVertices(const std::vector<dbg::Vertex *> &vertices);
     void addSubpath(const dbg::CompactPath &cpath);
     void removeSubpath(const dbg::CompactPath &cpath);
     void addRead(AlignedRead &&read);
@@ -211,23 +252,34 @@ void RecordStorage::fill(I begin, I end, dbg::SparseDBG &dbg, size_t min_read_si
         logger.info() << "Storing suffixes of read paths of length up to " << this->max_len << std::endl;
     }
     ParallelRecordCollector<std::tuple<size_t, std::string, dbg::CompactPath>> tmpReads(threads);
+//    Extensions are added to vertex records after every batch of reads, so only extensions of one batch are kept
+    std::vector<ExtensionShards> extensions(threads, ExtensionShards(extension_shards));
     ParallelCounter cnt(threads);
-    std::function<void(size_t, StringContig &)> read_task = [this, min_read_size, &tmpReads, &cnt, &dbg](size_t pos, StringContig & scontig) {
+    dbg::FrozenDBG frozen(dbg, threads);
+//    Each thread reuses its alignment buffer and paths are packed into shared blocks of the arena
+    std::vector<dbg::AlignmentBuffer> buffers(threads);
+    std::function<void(size_t, StringContig &)> read_task = [this, min_read_size, &tmpReads, &cnt, &dbg, &frozen, &buffers, &extensions](size_t pos, StringContig & scontig) {
         Contig contig = scontig.makeContig();
         if(contig.size() < min_read_size) {
             tmpReads.emplace_back(pos, contig.id, dbg::CompactPath());
             return;
         }
-        dbg::GraphAlignment path = dbg::GraphAligner(dbg).align(contig.seq);
-        dbg::CompactPath cpath(path);
-        dbg::GraphAlignment rcPath = path.RC();
-        dbg::CompactPath crcPath(rcPath);
-        addSubpath(cpath);
-        addSubpath(crcPath);
+        dbg::AlignmentBuffer &buffer = buffers[omp_get_thread_num()];
+        dbg::GraphAligner(dbg, frozen).align(contig.seq, buffer);
+        dbg::CompactPath cpath = dbg::CompactPath::FromBuffer(buffer, arena);
+        dbg::CompactPath crcPath = dbg::CompactPath::RCFromBuffer(buffer, arena);
+        collectSubpath(cpath, extensions[omp_get_thread_num()]);
+        collectSubpath(crcPath, extensions[omp_get_thread_num()]);
         cnt += cpath.size();
         tmpReads.emplace_back(pos, contig.id, cpath);
     };
-    processRecords(begin, end, logger, threads, read_task);
+    ParallelProcessor<StringContig> processor(read_task, logger, threads);
+    processor.max_batch_length = fill_batch_length;
+    processor.doAfter = [this, threads, &extensions]() {
+        if(track_suffixes)
+            addExtensions(threads, extensions);
+    };
+    processor.processRecords(begin, end);
     reads.resize(tmpReads.size());
     for(auto &rec : tmpReads) {
         VERIFY(std::get<0>(rec) < reads.size());
@@ -174,65 +174,111 @@ void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, co
     dbg = std::move(subgraph);
 }
 
+//Old edges that were split are given by their start vertices and sequences. Path is walked along old edge sequences in
+//the changed graph and skips are moved to the new first and last edges.
+CompactPath remapPath(const CompactPath &path, const std::unordered_map<const Vertex *, std::vector<Sequence>> &old_edges) {
+    std::vector<Edge *> edges;
+    size_t first_edges = 0;
+    Vertex *cur = &path.start();
+    for(size_t i = 0; i < path.size(); i++) {
+        const Sequence *old_seq = nullptr;
+        auto it = old_edges.find(cur);
+        if(it != old_edges.end()) {
+            for(const Sequence &seq : it->second) {
+                if(seq[0] == path[i])
+                    old_seq = &seq;
+            }
+        }
+        if(old_seq == nullptr) {
+            Edge &edge = cur->getOutgoing(path[i]);
+            edges.emplace_back(&edge);
+            cur = edge.end();
+        } else {
+            size_t pos = 0;
+            while(pos < old_seq->size()) {
+                Edge &edge = cur->getOutgoing((*old_seq)[pos]);
+                edges.emplace_back(&edge);
+                pos += edge.size();
+                cur = edge.end();
+            }
+            VERIFY_OMP(pos == old_seq->size(), "Split edge does not match its old sequence");
+        }
+        if(i == 0)
+            first_edges = edges.size();
+    }
+    size_t from = 0;
+    size_t left = path.leftSkip();
+    while(from + 1 < first_edges && left >= edges[from]->size()) {
+        left -= edges[from]->size();
+        from++;
+    }
+    size_t to = edges.size();
+    size_t right = path.rightSkip();
+    while(to > from + 1 && right >= edges[to - 1]->size()) {
+        right -= edges[to - 1]->size();
+        to--;
+    }
+    std::vector<char> cpath;
+    for(size_t i = from; i < to; i++) {
+        cpath.push_back(edges[i]->seq[0]);
+    }
+    Vertex &start = from == 0 ? path.start() : *edges[from - 1]->end();
+    return {start, Sequence(cpath), left, right};
+}
+
 void AddConnections(logging::Logger &logger, size_t threads, SparseDBG &dbg, const std::vector<RecordStorage *> &storages,
                const std::vector<Connection> &connections) {
     logger.info() << "Adding new connections to the graph" << std::endl;
-    size_t k = dbg.hasher().getK();
-    std::vector<EdgePosition> break_positions;
-    logger.trace() << "Splitting graph edges" << std::endl;
     std::vector<Sequence> seqs;
     for(const Connection &connection : connections)
         seqs.emplace_back(connection.connection);
-    SparseDBG subgraph = dbg.AddNewSequences(logger, threads, seqs);
-    mergeAll(logger, subgraph, threads);
-    subgraph.fillAnchors(500, logger, threads);
-    subgraph.checkConsistency(threads, logger);
-//    subgraph.checkDBGConsistency(threads, logger);
-    GraphAligner aligner(subgraph);
-    std::function<void(size_t, Edge &)> task = [&aligner](size_t num, Edge &edge) {
-        GraphAlignment al = aligner.align(edge.start()->seq + edge.seq);
-        VERIFY(al.len() == edge.size());
-        edge.is_reliable = (al.size() == 1 && al[0].left == 0 && al[0].right == al[0].contig().size());
-        edge.rc().is_reliable = edge.is_reliable;
-    };
-    processObjects(dbg.edgesUnique().begin(), dbg.edgesUnique().end(), logger, threads, task);
-    logger.trace() << "Realigning reads to the new graph" << std::endl;
-    for(RecordStorage* sit : storages) {
-        RecordStorage &storage = *sit;
-        RecordStorage new_storage(subgraph, storage.getMinLen(), storage.getMaxLen(), threads, storage.getLogger(),
-                                  storage.isTrackingCov(), false);
-        for(AlignedRead &al : storage) {
-            new_storage.addRead(AlignedRead(al.id));
-        }
-        omp_set_num_threads(threads);
-#pragma omp parallel for default(none) schedule(dynamic, 100) shared(storage, new_storage, subgraph)
-        for(size_t i = 0; i < storage.size(); i++) {
-            AlignedRead &old_read = storage[i];
-            if(!old_read.valid())
-                continue;
-            AlignedRead &new_read = new_storage[i];
-            GraphAlignment al = old_read.path.getAlignment();
-            bool good = true;
-            for(Segment<Edge> &seg : al) {
-                if(!seg.contig().is_reliable) {
-                    good = false;
-                    break;
+//    Only reads that pass through split edges are moved. Their paths are removed from storages while the old edges
+//    still exist and are remapped along old edge sequences after the graph is changed.
+    std::unordered_map<const Vertex *, std::vector<Sequence>> old_edges;
+    std::vector<std::vector<size_t>> moved(storages.size());
+    std::function<void(const std::vector<Edge *> &)> detach =
+            [&old_edges, &moved, &storages, &logger, threads](const std::vector<Edge *> &split_edges) {
+        std::unordered_set<const Edge *> split(split_edges.begin(), split_edges.end());
+        for(Edge *edge : split_edges)
+            old_edges[edge->start()].emplace_back(edge->seq);
+        for(size_t j = 0; j < storages.size(); j++) {
+            RecordStorage &storage = *storages[j];
+            ParallelRecordCollector<size_t> affected(threads);
+            omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(dynamic, 100) shared(storage, split, affected)
+            for(size_t i = 0; i < storage.size(); i++) {
+                AlignedRead &read = storage[i];
+                if(!read.valid())
+                    continue;
+                for(const Segment<Edge> &seg : read.path.getAlignment()) {
+                    if(split.find(&seg.contig()) != split.end()) {
+                        storage.removeSubpath(read.path);
+                        storage.removeSubpath(read.path.RC());
+                        affected.add(i);
+                        break;
+                    }
                 }
             }
-            GraphAlignment new_al;
-            if(good) {
-                Vertex &start = subgraph.getVertex(old_read.path.start());
-                new_al = CompactPath(start, old_read.path.cpath(), old_read.path.leftSkip(), old_read.path.rightSkip()).getAlignment();
-            } else {
-                new_al = GraphAligner(subgraph).align(al.Seq());
-            }
-            new_storage.reroute(new_read, new_al, "Remapping");
-            new_storage.apply(new_read);
+            moved[j] = affected.collect();
+            logger.trace() << "Detached " << moved[j].size() << " reads from split edges" << std::endl;
+        }
+    };
+    std::vector<Vertex *> new_vertices = insertSequences(logger, dbg, seqs, 500, threads, detach);
+    dbg.checkConsistency(threads, logger);
+    logger.trace() << "Remapping reads to the new graph" << std::endl;
+    for(size_t j = 0; j < storages.size(); j++) {
+        RecordStorage &storage = *storages[j];
+        std::vector<size_t> &reads = moved[j];
+        storage.addVertices(new_vertices);
+        omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(dynamic, 100) shared(storage, reads, old_edges)
+        for(size_t i = 0; i < reads.size(); i++) {
+            AlignedRead &read = storage[reads[i]];
+            read.path = remapPath(read.path, old_edges);
+            storage.addSubpath(read.path);
+            storage.addSubpath(read.path.RC());
         }
-        new_storage.log_changes = storage.log_changes;
-        storage = std::move(new_storage);
     }
-    dbg = std::move(subgraph);
 }
 
 Connection::Connection(dbg::EdgePosition pos1, dbg::EdgePosition pos2, Sequence connection) :
@@ -3,19 +3,23 @@
 using namespace hashing;
 std::vector<htype>
 constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads, const RollingHash &hasher,
-                    const size_t w) {
+                    const size_t w, const std::experimental::filesystem::path &spill_dir, size_t memory_limit) {
     logger.info() << "Reading reads" << std::endl;
     std::vector<std::vector<htype>> prev;
     prev.resize(threads);
     const size_t buffer_size = 1000000000;
     logger.info() << "Extracting minimizers" << std::endl;
     size_t min_read_size = hasher.getK() + w - 1;
-    ParallelRecordCollector<htype> hashs(threads);
-    std::function<void(size_t, StringContig &)> task = [min_read_size, w, &hasher, &hashs](size_t pos, StringContig & contig) {
+    if(memory_limit > 0)
+        logger.info() << "Minimizer collection is limited to " << memory_limit / 1024 / 1024 << "Mb of memory" << std::endl;
+    BucketSpillCollector<htype> hashs(spill_dir, threads, memory_limit);
+    std::vector<MinimizerKernel> kernels(threads, MinimizerKernel(hasher, w));
+    std::vector<std::vector<htype>> buffers(threads);
+    std::function<void(size_t, StringContig &)> task = [min_read_size, &kernels, &buffers, &hashs](size_t pos, StringContig & contig) {
         Sequence seq = contig.makeSequence();
         if(seq.size() >= min_read_size) {
-            MinimizerCalculator calc(seq, hasher, w);
-            std::vector<htype> minimizers(calc.minimizerHashs());
+            std::vector<htype> &minimizers = buffers[omp_get_thread_num()];
+            kernels[omp_get_thread_num()].minimizerHashs(seq, minimizers);
             if (minimizers.size() > 10) {
                 std::sort(minimizers.begin(), minimizers.end());
                 minimizers.erase(std::unique(minimizers.begin(), minimizers.end()), minimizers.end());
@@ -27,8 +31,12 @@ constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size
     processRecords(reader.begin(), reader.end(), logger, threads, task);
 
     logger.info() << "Finished read processing" << std::endl;
-    logger.info() << hashs.size() << " hashs collected. Starting sorting." << std::endl;
-    std::vector<htype> hash_list = hashs.collectUnique();
+    if(hashs.spilledBytes() > 0)
+        logger.info() << hashs.spilledBytes() / 1024 / 1024 << "Mb of minimizers were spilled to " << spill_dir << std::endl;
+    logger.info() << hashs.size() << " hashs collected in memory. Starting sorting." << std::endl;
+    std::vector<htype> hash_list = hashs.collectUnique(threads);
+    if(hashs.spilledBytes() > 0)
+        logger.info() << "Total spill volume: " << hashs.spilledBytes() / 1024 / 1024 << "Mb" << std::endl;
     //    TODO replace with parallel std::sort
 //    __gnu_parallel::sort(hash_list.begin(), hash_list.end());
 //    hash_list.erase(std::unique(hash_list.begin(), hash_list.end()), hash_list.end());
@@ -9,7 +9,13 @@
 #include "sequences/seqio.hpp"
 #include "common/logging.hpp"
 #include "common/omp_utils.hpp"
+#include "common/bucket_spill_collector.hpp"
 
+//Memory cap in bytes for collection of minimizer hashes used by DBGPipeline. Zero means that all hashes are sorted in memory.
+inline size_t minimizer_memory_limit = 0;
+
+//If memory_limit is not zero, minimizers that do not fit into it are spilled into bucket files in spill_dir.
 std::vector<hashing::htype> constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads,
-                                       const hashing::RollingHash &hasher, const size_t w);
+                                       const hashing::RollingHash &hasher, const size_t w,
+                                       const std::experimental::filesystem::path &spill_dir = "", size_t memory_limit = 0);
 
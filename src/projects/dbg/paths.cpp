@@ -68,6 +68,7 @@ double dbg::Path::minCoverage() const {
 
 Sequence dbg::Path::Seq() const {
     SequenceBuilder sb;
+    sb.reserve(start().seq.size() + len());
     sb.append(start().seq);
     for (const Edge *e : path) {
         sb.append(e->seq);
@@ -77,6 +78,7 @@ Sequence dbg::Path::Seq() const {
 
 Sequence dbg::Path::truncSeq() const {
     SequenceBuilder sb;
+    sb.reserve(len());
     for (const Edge *e : path) {
         sb.append(e->seq);
     }
@@ -456,18 +458,39 @@ dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq, dbg::Edge *edg
 }
 
 dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq) const {
-    std::vector<hashing::KWH> kmers = dbg.extractVertexPositions(seq, 1);
+    AlignmentBuffer buffer;
+    align(seq, buffer);
+    if(buffer.edges.empty())
+        return {};
+    std::vector<Segment<Edge>> als;
+    als.reserve(buffer.edges.size());
+    for(Edge *edge : buffer.edges)
+        als.emplace_back(*edge, 0, edge->size());
+    als.front().left += buffer.left_skip;
+    als.back().right -= buffer.right_skip;
+    return {buffer.start, std::move(als)};
+}
+
+void dbg::GraphAligner::align(const Sequence &seq, AlignmentBuffer &buffer) const {
+    dbg.extractVertexPositions(seq, buffer.kmers, 1);
+    std::vector<hashing::KWH> &kmers = buffer.kmers;
     size_t k = dbg.hasher().getK();
-    GraphAlignment res;
+    buffer.start = nullptr;
+    buffer.edges.clear();
+    buffer.left_skip = 0;
+    buffer.right_skip = 0;
     if (kmers.size() == 0) {
         hashing::KWH kwh(dbg.hasher(), seq, 0);
         while (true) {
-            if (dbg.isAnchor(kwh.hash())) {
-                EdgePosition pos = dbg.getAnchor(kwh);
+            EdgePosition pos = dbg.findAnchor(kwh);
+            if (pos.edge != nullptr) {
                 VERIFY(kwh.pos < pos.pos);
                 VERIFY(pos.pos + seq.size() - kwh.pos <= pos.edge->size() + k);
-                Segment<Edge> seg(*pos.edge, pos.pos - kwh.pos, pos.pos + seq.size() - kwh.pos - k);
-                return {pos.edge->start(), std::vector<Segment<Edge>>({seg})};
+                buffer.start = pos.edge->start();
+                buffer.edges.push_back(pos.edge);
+                buffer.left_skip = pos.pos - kwh.pos;
+                buffer.right_skip = pos.edge->size() + k + kwh.pos - pos.pos - seq.size();
+                return;
             }
             if (!kwh.hasNext()) {
 #pragma omp critical
@@ -476,7 +499,7 @@ dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq) const {
                     std::cout << seq << std::endl;
                     abort();
                 };
-                return res;
+                return;
             }
             kwh = kwh.next();
         }
@@ -493,10 +516,25 @@ dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq) const {
         Edge &rcedge = rcstart.getOutgoing(seq[kmers.front().pos - 1] ^ 3);
         Edge &edge = rcedge.rc();
         VERIFY(edge.size() >= kmers.front().pos);
-        Segment<Edge> seg(edge, edge.size() - kmers.front().pos, edge.size());
-        res += seg;
+        buffer.start = edge.start();
+        buffer.edges.push_back(&edge);
+        buffer.left_skip = edge.size() - kmers.front().pos;
+    } else {
+        buffer.start = prestart;
     }
     size_t cpos = kmers.front().pos + k;
+    if(frozen != nullptr) {
+        FrozenDBG::id_type v = frozen->id(*prestart);
+        FrozenDBG::id_type e;
+        while(cpos < seq.size() && (e = frozen->outgoing(v, seq[cpos])) != FrozenDBG::none) {
+            size_t len = std::min<size_t>(frozen->edgeSize(e), seq.size() - cpos);
+            buffer.edges.push_back(&frozen->edge(e));
+            buffer.right_skip = frozen->edgeSize(e) - len;
+            cpos += len;
+            v = frozen->end(e);
+        }
+        prestart = &frozen->vertex(v);
+    }
     while(cpos < seq.size()) {
         if(!prestart->hasOutgoing(seq[cpos])) {
             std::cout << "No outgoing for middle\n" << seq << "\n" << cpos << " " << prestart->getId() <<
@@ -509,11 +547,11 @@ dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq) const {
         }
         Edge &next = prestart->getOutgoing(seq[cpos]);
         size_t len = std::min<size_t>(next.size(), seq.size() - cpos);
-        res += Segment<Edge>(next, 0, len);
+        buffer.edges.push_back(&next);
+        buffer.right_skip = next.size() - len;
         cpos += len;
         prestart = next.end();
     }
-    return std::move(res);
 }
 
 dbg::GraphAlignment dbg::GraphAligner::align(const dbg::EdgePosition &pos, const Sequence &seq) const {
@@ -561,9 +599,9 @@ dbg::GraphAligner::oldEdgeAlign(dbg::Edge
                 if (start.hasOutgoing(seq[kwh.pos + k]))
                     edge = &dbg.getVertex(kwh).getOutgoing(seq[kwh.pos + k]);
             }
-            if (edge == nullptr && dbg.isAnchor(kwh.hash())) {
-                EdgePosition gpos = dbg.getAnchor(kwh);
-                if (gpos.edge->seq[gpos.pos] == seq[kwh.pos + k]) {
+            if (edge == nullptr) {
+                EdgePosition gpos = dbg.findAnchor(kwh);
+                if (gpos.edge != nullptr && gpos.edge->seq[gpos.pos] == seq[kwh.pos + k]) {
                     edge = gpos.edge;
                     pos = gpos.pos;
                 }
@@ -594,43 +632,40 @@ std::vector<dbg::PerfectAlignment<Contig, dbg::Edge>> dbg::GraphAligner::careful
                 if ((res.empty() || kwh.pos > res.back().seg_from.right)
                     && kwh.pos > 0 && rcVertex.hasOutgoing(seq[kwh.pos - 1] ^ 3)) {
                     Edge &edge = rcVertex.getOutgoing(seq[kwh.pos - 1] ^ 3);
-                    size_t len = 1;
-                    while (len < edge.size() && len < kwh.pos && edge.seq[len] == (seq[kwh.pos - len - 1] ^ 3))
-                        len += 1;
+                    size_t len = 1 + edge.seq.Subseq(1).commonPrefix(!seq.Subseq(0, kwh.pos - 1));
                     res.emplace_back(Segment<Contig>(contig, kwh.pos - len, kwh.pos),
                                      Segment<Edge>(edge.rc(), edge.size() - len, edge.size()));
                 }
                 if (kwh.pos + k < seq.size() && vertex.hasOutgoing(seq[kwh.pos + k])) {
                     Edge &edge = vertex.getOutgoing(seq[kwh.pos + k]);
-                    size_t len = 1;
-                    while (len < edge.size() && kwh.pos + k + len < seq.size() &&
-                           edge.seq[len] == seq[kwh.pos + k + len])
-                        len += 1;
+                    size_t len = 1 + edge.seq.Subseq(1).commonPrefix(seq.Subseq(kwh.pos + k + 1));
                     res.emplace_back(Segment<Contig>(contig, kwh.pos, kwh.pos + len),
                                      Segment<Edge>(edge, 0, len));
                 }
-            } else if ((res.empty() || kwh.pos > res.back().seg_from.right) && dbg.isAnchor(kwh.hash())) {
-                EdgePosition pos = dbg.getAnchor(kwh);
-//                TODO replace this code with a call to expand method of PerfectAlignment class after each edge is marked by its full sequence
-                Edge &edge = *pos.edge;
-                Vertex &start = *pos.edge->start();
-                CompositeSequence edge_seq({start.seq, edge.seq});
-                size_t left_from = kwh.pos;
-                size_t right_from = kwh.pos + k;
-                size_t left_to = pos.pos;
-                size_t right_to = pos.pos + k;
-                while (left_from > 0 && left_to > 0 && edge_seq[left_to - 1] == seq[left_from - 1]) {
-                    left_from -= 1;
-                    left_to -= 1;
-                }
-                while (right_from < seq.size() && right_to < edge_seq.size() &&
-                       seq[right_from] == edge_seq[right_to]) {
-                    right_from += 1;
-                    right_to += 1;
-                }
-                if (left_to - left_from > k) {
-                    res.emplace_back(Segment<Contig>(contig, left_from, right_from - k),
-                                     Segment<Edge>(edge, left_to, right_to - k));
+            } else if (res.empty() || kwh.pos > res.back().seg_from.right) {
+                EdgePosition pos = dbg.findAnchor(kwh);
+                if (pos.edge != nullptr) {
+//                    TODO replace this code with a call to expand method of PerfectAlignment class after each edge is marked by its full sequence
+                    Edge &edge = *pos.edge;
+                    Vertex &start = *pos.edge->start();
+                    CompositeSequence edge_seq({start.seq, edge.seq});
+                    size_t left_from = kwh.pos;
+                    size_t right_from = kwh.pos + k;
+                    size_t left_to = pos.pos;
+                    size_t right_to = pos.pos + k;
+                    while (left_from > 0 && left_to > 0 && edge_seq[left_to - 1] == seq[left_from - 1]) {
+                        left_from -= 1;
+                        left_to -= 1;
+                    }
+                    while (right_from < seq.size() && right_to < edge_seq.size() &&
+                           seq[right_from] == edge_seq[right_to]) {
+                        right_from += 1;
+                        right_to += 1;
+                    }
+                    if (left_to - left_from > k) {
+                        res.emplace_back(Segment<Contig>(contig, left_from, right_from - k),
+                                         Segment<Edge>(edge, left_to, right_to - k));
+                    }
                 }
             }
         }
@@ -644,12 +679,8 @@ std::vector<dbg::PerfectAlignment<Contig, dbg::Edge>> dbg::GraphAligner::careful
 PerfectAlignment<Contig, dbg::Edge> bestExtension(const Vertex &vertex, const Segment<Contig> &seg) {
     PerfectAlignment<Contig, dbg::Edge> best({seg.contig(), seg.left, seg.left}, {Edge::fake(), 0, 0});
     for(Edge &edge : vertex) {
-        size_t len = 0;
-        while(len < edge.size() && seg.left + vertex.seq.size() + len < seg.contig().size()) {
-            if(seg.contig()[seg.left + vertex.seq.size() + len] != edge.seq[len])
-                break;
-            len++;
-        }
+        size_t from = std::min(seg.left + vertex.seq.size(), seg.contig().size());
+        size_t len = edge.seq.commonPrefix(seg.contig().seq.Subseq(from));
 //        std::cout << len << std::endl;
 //        std::cout << Segment<Contig>(seg.contig(), seg.left + vertex.seq.size(),
 //                                     std::min(seg.contig().size(), seg.left + vertex.seq.size() + 200)).seq() << std::endl;
@@ -662,12 +693,8 @@ PerfectAlignment<Contig, dbg::Edge> bestExtension(const Vertex &vertex, const Se
 }
 
 PerfectAlignment<Contig, dbg::Edge> bestExtension(Edge &edge, const Segment<Contig> &seg) {
-    size_t len = 0;
-    while(len < edge.size() && seg.left + edge.start()->seq.size() + len < seg.contig().size()) {
-        if(seg.contig()[seg.left + edge.start()->seq.size() + len] != edge.seq[len])
-            break;
-        len++;
-    }
+    size_t from = std::min(seg.left + edge.start()->seq.size(), seg.contig().size());
+    size_t len = edge.seq.commonPrefix(seg.contig().seq.Subseq(from));
     return {Segment<Contig>(seg.contig(), seg.left, seg.left + len), Segment<Edge>(edge, 0, len)};
 }
 
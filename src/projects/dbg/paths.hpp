@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sparse_dbg.hpp"
+#include "frozen_dbg.hpp"
 namespace dbg {
     class Path {
     private:
@@ -136,18 +137,35 @@ namespace dbg {
         size_t size() {return seg_from.size();}
     };
 
+//    Alignment of a sequence stored as a list of edges with the skipped prefix of the first edge and the skipped suffix of
+//    the last one. Filled by GraphAligner::align. Memory of the buffer is reused when one thread aligns many sequences.
+    struct AlignmentBuffer {
+        Vertex *start = nullptr;
+        std::vector<Edge *> edges;
+        size_t left_skip = 0;
+        size_t right_skip = 0;
+        std::vector<hashing::KWH> kmers;
+        SequenceBuilder nucls;
+    };
+
     class GraphAligner {
     private:
         SparseDBG &dbg;
+        const FrozenDBG *frozen = nullptr;
         PerfectAlignment<Contig, dbg::Edge> extendLeft(const hashing::KWH &kwh, Contig &contig) const;
         PerfectAlignment<Contig, dbg::Edge> extendRight(const hashing::KWH &kwh, Contig &contig) const;
     public:
         explicit GraphAligner(SparseDBG &dbg) : dbg(dbg) {
         }
 
+//        Aligner for read-only phases. Frozen index must be built for the same graph.
+        GraphAligner(SparseDBG &dbg, const FrozenDBG &frozen) : dbg(dbg), frozen(&frozen) {
+        }
+
         GraphAlignment align(const EdgePosition &pos, const Sequence &seq) const;
         GraphAlignment align(const Sequence &seq, Edge *edge_to, size_t pos_to);
         GraphAlignment align(const Sequence &seq) const;
+        void align(const Sequence &seq, AlignmentBuffer &buffer) const;
         std::vector<PerfectAlignment<Contig, Edge>> carefulAlign(Contig &contig) const;
         std::vector<PerfectAlignment<Edge, Edge>> oldEdgeAlign(Edge &contig) const;
         std::vector<PerfectAlignment<Contig, Edge>> sparseAlign(Contig &contig) const;
@@ -1,7 +1,13 @@
 #include "sparse_dbg.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <parallel/algorithm>
 using namespace dbg;
 
 Edge Edge::_fake = Edge(nullptr, nullptr, Sequence());
+HashIndexType SparseDBG::vertex_index_type = HashIndexType::open_addressing;
 
 size_t Edge::updateTipSize() const {
     size_t new_val = 0;
@@ -176,7 +182,7 @@ Sequence Edge::firstNucl() const {
 //    return os;
 //}
 
-Vertex::Vertex(hashing::htype hash, Vertex *_rc) : hash_(hash), rc_(_rc), canonical(false) {
+Vertex::Vertex(hashing::htype hash, Vertex *_rc, bool _canonical) : hash_(hash), rc_(_rc), canonical(_canonical) {
     omp_init_lock(&writelock);
 }
 
@@ -240,15 +246,23 @@ void Vertex::incCoverage() {
     rc().coverage_ += 1;
 }
 
-void Vertex::setSequence(const Sequence &_seq) {
+void Vertex::setSequence(const Sequence &_seq, SequenceArena &arena) {
+    if(seq_filled_.load(std::memory_order_acquire)) {
+#ifdef LJA_HASH64
+        VERIFY_MSG(seq == _seq, "Two different k-mers have the same 64-bit hash. Please rebuild LJA with -DLJA_HASH_WIDTH=128");
+#endif
+        return;
+    }
     lock();
     if (seq.empty()) {
         if (seq.empty()) {
-            seq = Sequence(_seq.str());
+            seq = arena.copy(_seq);
             unlock();
             rc_->lock();
-            rc_->seq = !_seq;
+            rc_->seq = !seq;
+            rc_->seq_filled_.store(true, std::memory_order_release);
             rc_->unlock();
+            seq_filled_.store(true, std::memory_order_release);
         } else {
             unlock();
         }
@@ -258,6 +272,9 @@ void Vertex::setSequence(const Sequence &_seq) {
 //                VERIFY(false);
 //            }
 //            VERIFY(_seq == seq);
+#ifdef LJA_HASH64
+        VERIFY_MSG(seq == _seq, "Two different k-mers have the same 64-bit hash. Please rebuild LJA with -DLJA_HASH_WIDTH=128");
+#endif
         unlock();
     }
 }
@@ -267,15 +284,17 @@ void Vertex::clearSequence() {
         seq = Sequence();
         rc_->seq = Sequence();
     }
+    seq_filled_ = false;
+    rc_->seq_filled_ = false;
 }
 
 Edge &Vertex::addEdgeLockFree(const Edge &edge) {
     for (Edge &e : outgoing_) {
         if (edge.size() <= e.size()) {
-            if (edge.seq == e.seq.Subseq(0, edge.size())) {
+            if (e.seq.startsWith(edge.seq)) {
                 return e;
             }
-        } else if (edge.seq.Subseq(0, e.size()) == e.seq) {
+        } else if (edge.seq.startsWith(e.seq)) {
             e = edge;
             return e;
         }
@@ -290,6 +309,81 @@ void Vertex::addEdge(const Edge &e) {
     omp_unset_lock(&writelock);
 }
 
+void Vertex::stageEdge(Vertex *end, const Sequence &seq, SequenceArena &arena) {
+    VERIFY(!seq.empty());
+    StagedEdges *table = staged_.load(std::memory_order_acquire);
+    if(table == nullptr) {
+        auto *new_table = new StagedEdges();
+        if(staged_.compare_exchange_strong(table, new_table, std::memory_order_acq_rel))
+            table = new_table;
+        else
+            delete new_table;
+    }
+    std::atomic<StagedEdge *> *link = &table->slots[seq[0]];
+    StagedEdge *candidate = nullptr;
+    auto publish = [&]() {
+        candidate->edge.seq = arena.copy(seq);
+        candidate->ready.store(true, std::memory_order_release);
+    };
+    while(true) {
+        StagedEdge *branch = link->load(std::memory_order_acquire);
+        if(branch == nullptr) {
+            if(candidate == nullptr)
+                candidate = new StagedEdge(this, end);
+            if(link->compare_exchange_strong(branch, candidate, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                publish();
+                return;
+            }
+        }
+        StagedEdge *last = branch;
+        while(true) {
+            StagedEdge *longer = last->longer.load(std::memory_order_acquire);
+            while(longer != nullptr) {
+                last = longer;
+                longer = last->longer.load(std::memory_order_acquire);
+            }
+            const Sequence &other = last->waitSeq();
+            if(seq.size() <= other.size()) {
+                if(seq == other.Subseq(0, seq.size())) {
+                    delete candidate;
+                    return;
+                }
+                break;
+            }
+            if(seq.Subseq(0, other.size()) != other)
+                break;
+            if(candidate == nullptr)
+                candidate = new StagedEdge(this, end);
+            if(last->longer.compare_exchange_strong(longer, candidate, std::memory_order_acq_rel)) {
+                publish();
+                return;
+            }
+        }
+        link = &branch->next;
+    }
+}
+
+void Vertex::publishStagedEdges() {
+    StagedEdges *table = staged_.exchange(nullptr);
+    if(table == nullptr)
+        return;
+    for(std::atomic<StagedEdge *> &slot : table->slots) {
+        StagedEdge *branch = slot.load();
+        while(branch != nullptr) {
+            StagedEdge *next = branch->next.load();
+            while(branch->longer.load() != nullptr) {
+                StagedEdge *longer = branch->longer.load();
+                delete branch;
+                branch = longer;
+            }
+            addEdgeLockFree(branch->edge);
+            delete branch;
+            branch = next;
+        }
+    }
+    delete table;
+}
+
 Edge &Vertex::getOutgoing(unsigned char c) const {
     for (Edge &edge : outgoing_) {
         if (edge.seq[0] == c) {
@@ -331,16 +425,9 @@ void Vertex::clearOutgoing() {
     outgoing_.clear();
 }
 
-Vertex::Vertex(hashing::htype hash) : hash_(hash), rc_(new Vertex(hash, this)), canonical(true) {
-    omp_init_lock(&writelock);
-}
-
 Vertex::~Vertex() {
-    if (rc_ != nullptr) {
-        rc_->rc_ = nullptr;
-        delete rc_;
-    }
-    rc_ = nullptr;
+    publishStagedEdges();
+    omp_destroy_lock(&writelock);
 }
 
 void Vertex::sortOutgoing() {
@@ -361,8 +448,8 @@ bool Vertex::operator!=(const Vertex &other) const {
 
 void SparseDBG::checkSeqFilled(size_t threads, logging::Logger &logger) {
     logger.trace() << "Checking vertex sequences" << std::endl;
-    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> task =
-            [&logger](size_t pos, std::pair<const hashing::htype, Vertex> &pair) {
+    std::function<void(size_t, std::pair<const hashing::htype, VertexPair> &)> task =
+            [&logger](size_t pos, std::pair<const hashing::htype, VertexPair> &pair) {
                 const Vertex &vert = pair.second;
                 if (vert.seq.empty() || vert.rc().seq.empty()) {
                     logger.trace() << "Sequence not filled " << pair.first << std::endl;
@@ -402,72 +489,32 @@ SparseDBG SparseDBG::Subgraph(std::vector<Segment<Edge>> &pieces) {
         } else {
             right = &res.addVertex(rcSeg.contig().kmerSeq(rcSeg.left));
         }
-        left->addEdge(Edge(left, &right->rc(), seg.seq()));
-        right->addEdge(Edge(right, &left->rc(), rcSeg.seq()));
+//        Sequences in arena of this graph are views, so subgraph keeps its own copies
+        left->addEdge(Edge(left, &right->rc(), res.arena_.copy(seg.seq())));
+        right->addEdge(Edge(right, &left->rc(), res.arena_.copy(rcSeg.seq())));
     }
     return std::move(res);
 }
 
-SparseDBG SparseDBG::SplitGraph(const std::vector<EdgePosition> &breaks) {
-    SparseDBG res(hasher_);
-    for(Vertex &it : verticesUnique()) {
-        res.addVertex(it);
-    }
+void SparseDBG::splitEdgesAt(const std::vector<EdgePosition> &breaks, logging::Logger &logger, size_t threads) {
     std::unordered_set<Edge *> broken_edges;
     for(const EdgePosition &epos : breaks) {
         if(!epos.isBorder()) {
-            res.addVertex(epos.kmerSeq());
             broken_edges.emplace(epos.edge);
             broken_edges.emplace(&epos.edge->rc());
         }
     }
-    for(Edge &edge : edges()) {
-        if(broken_edges.find(&edge) == broken_edges.end()) {
-            Vertex &start = res.getVertex(*edge.start());
-            Vertex &end = res.getVertex(*edge.end());
-            Edge new_edge(&start, &end, edge.seq);
-            start.addEdge(new_edge);
-        } else {
-            Vertex &newVertex = res.getVertex(*edge.start());
-            res.processEdge(newVertex, edge.seq);
-        }
-    }
-    return std::move(res);
-}
-
-SparseDBG SparseDBG::AddNewSequences(logging::Logger &logger, size_t threads, const std::vector<Sequence> &new_seqs) {
-    SparseDBG res(hasher_);
-    for(Vertex &it : verticesUnique()) {
-        res.addVertex(it);
-    }
-    for(const Sequence &seq: new_seqs) {
-        hashing::KWH kwh(hasher_, seq, 0);
-        while(true) {
-            if(!res.containsVertex(kwh.hash())) {
-                res.addVertex(kwh);
-            }
-            if(!kwh.hasNext())
-                break;
-            kwh = kwh.next();
-        }
+    for(const EdgePosition &epos : breaks) {
+        if(!epos.isBorder())
+            addVertex(epos.kmerSeq());
     }
-    std::function<void(size_t, Edge &)> task = [&res](size_t num, Edge &edge) {
-        res.processEdge(edge);
-    };
-    omp_set_num_threads(threads);
-    processObjects(this->edgesUnique().begin(), this->edgesUnique().end(), logger, threads, task);
-    std::function<void(size_t, const Sequence &)> task1 = [&res](size_t num, const Sequence &seq) {
-        res.processRead(seq);
-    };
-    ParallelProcessor<const Sequence>(task1, logger, threads).processObjects(new_seqs.begin(), new_seqs.end(), 1024);
-//    processObjects<std::vector<Sequence>::const_iterator>(new_seqs.begin(), new_seqs.end(), logger, threads, task1);
-    return std::move(res);
+    splitEdges({broken_edges.begin(), broken_edges.end()}, logger, threads);
 }
 
 void SparseDBG::checkConsistency(size_t threads, logging::Logger &logger) {
     logger.trace() << "Checking consistency" << std::endl;
-    std::function<void(size_t, std::pair<const hashing::htype, Vertex> &)> task =
-            [this](size_t pos, std::pair<const hashing::htype, Vertex> &pair) {
+    std::function<void(size_t, std::pair<const hashing::htype, VertexPair> &)> task =
+            [this](size_t pos, std::pair<const hashing::htype, VertexPair> &pair) {
                 const Vertex &vert = pair.second;
                 vert.checkConsistency();
                 vert.rc().checkConsistency();
@@ -485,8 +532,8 @@ void SparseDBG::checkDBGConsistency(size_t threads, logging::Logger &logger) {
                     if(this->containsVertex(kwh.hash())) {
                         VERIFY_OMP((kwh.pos == 0 && this->getVertex(kwh) == *edge.start()) || (kwh.pos == edge.size() && this->getVertex(kwh) == *edge.end()), "Vertex kmer index corruption");
                     }
-                    if(this->isAnchor(kwh.hash())) {
-                        EdgePosition ep = getAnchor(kwh);
+                    EdgePosition ep = this->findAnchor(kwh);
+                    if(ep.edge != nullptr) {
                         VERIFY_OMP(ep.edge == &edge && ep.pos == kwh.pos, "Anchor kmer index corruption " + itos(ep.pos) + " " +
                                 itos(ep.edge->size()));
                     }
@@ -540,7 +587,7 @@ void SparseDBG::checkDBGConsistency(size_t threads, logging::Logger &logger) {
 Vertex &SparseDBG::addVertex(const hashing::KWH &kwh) {
     Vertex &newVertex = innerAddVertex(kwh.hash());
     Vertex &res = kwh.isCanonical() ? newVertex : newVertex.rc();
-    res.setSequence(kwh.getSeq());
+    res.setSequence(kwh.getSeq(), arena_);
     return res;
 }
 
@@ -551,10 +598,10 @@ Vertex &SparseDBG::addVertex(const Sequence &seq) {
 Vertex &SparseDBG::addVertex(const Vertex &other_graph_vertex) {
     Vertex &newVertex = innerAddVertex(other_graph_vertex.hash());
     if(other_graph_vertex.isCanonical()) {
-        newVertex.setSequence(other_graph_vertex.seq);
+        newVertex.setSequence(other_graph_vertex.seq, arena_);
         return newVertex;
     } else {
-        newVertex.setSequence(!other_graph_vertex.seq);
+        newVertex.setSequence(!other_graph_vertex.seq, arena_);
         return newVertex.rc();
     }
 }
@@ -592,16 +639,110 @@ std::array<Vertex *, 2> SparseDBG::getVertices(hashing::htype hash) {
     return {&res, &res.rc()};
 }
 
+void AnchorIndex::insertConcurrent(const std::vector<Record> &values, size_t threads) {
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(values) schedule(static, 1 << 14)
+    for(size_t i = 0; i < values.size(); i++) {
+        const Record &rec = values[i];
+        uint8_t t = tag(rec.key);
+        for(size_t slot = home(rec.key);; slot = next(slot)) {
+            uint8_t expected = 0;
+            if(__atomic_load_n(&tags[slot], __ATOMIC_RELAXED) == 0 &&
+                    __atomic_compare_exchange_n(&tags[slot], &expected, t, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                records[slot] = rec;
+                break;
+            }
+        }
+    }
+    cnt += values.size();
+}
+
+//Table is rebuilt with load factor 0.6 and grows when load factor exceeds 0.8
+void AnchorIndex::rehash(size_t n, size_t threads) {
+    std::vector<Record> values;
+    values.reserve(cnt);
+    for(size_t slot = 0; slot < tags.size(); slot++)
+        if(tags[slot] != 0)
+            values.emplace_back(records[slot]);
+    size_t capacity = std::max<size_t>(n * 5 / 3, 16);
+    tags = std::vector<uint8_t>(capacity, 0);
+    records = std::vector<Record>(capacity);
+    cnt = 0;
+    insertConcurrent(values, threads);
+}
+
+void AnchorIndex::emplace(hashing::htype hash, const EdgePosition &ep) {
+    if((cnt + 1) * 5 > tags.size() * 4)
+        rehash(cnt + 1, 1);
+    size_t slot = findSlot(hash);
+    if(tags[slot] != 0)
+        return;
+    VERIFY(ep.pos <= uint32_t(-1));
+    tags[slot] = tag(hash);
+    records[slot] = {hash, ep.edge, uint32_t(ep.pos)};
+    cnt++;
+}
+
+void AnchorIndex::set(hashing::htype hash, const EdgePosition &ep) {
+    emplace(hash, ep);
+    Record &rec = records[findSlot(hash)];
+    rec.edge = ep.edge;
+    rec.pos = ep.pos;
+}
+
+//Backward shift deletion: records after the removed one are moved closer to their home slots so that no tombstones are needed
+void AnchorIndex::erase(hashing::htype hash) {
+    if(cnt == 0)
+        return;
+    size_t hole = findSlot(hash);
+    if(tags[hole] == 0)
+        return;
+    for(size_t slot = next(hole); tags[slot] != 0; slot = next(slot)) {
+        size_t h = home(records[slot].key);
+        bool stays = hole <= slot ? hole < h && h <= slot : hole < h || h <= slot;
+        if(!stays) {
+            tags[hole] = tags[slot];
+            records[hole] = records[slot];
+            hole = slot;
+        }
+    }
+    tags[hole] = 0;
+    cnt--;
+}
+
+void AnchorIndex::insertAll(std::vector<std::pair<key_type, EdgePosition>> &&values, size_t threads) {
+    typedef std::pair<key_type, EdgePosition> value_type;
+    __gnu_parallel::sort(values.begin(), values.end(), [](const value_type &a, const value_type &b) {return a.first < b.first;});
+    values.erase(std::unique(values.begin(), values.end(), [](const value_type &a, const value_type &b) {return a.first == b.first;}), values.end());
+    std::vector<Record> new_records;
+    new_records.reserve(values.size());
+    for(const value_type &val : values) {
+        if(cnt > 0 && tags[findSlot(val.first)] != 0)
+            continue;
+        VERIFY(val.second.pos <= uint32_t(-1));
+        new_records.push_back({val.first, val.second.edge, uint32_t(val.second.pos)});
+    }
+    std::vector<value_type>().swap(values);
+    if((cnt + new_records.size()) * 5 > tags.size() * 4)
+        rehash(cnt + new_records.size(), threads);
+    insertConcurrent(new_records, threads);
+}
+
 void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads) {
+    fillAnchors(w, logger, threads, {});
+}
+
+void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads,
+                            const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &to_add) {
     logger.trace() << "Adding anchors from long edges for alignment" << std::endl;
-    ParallelRecordCollector<std::pair<const hashing::htype, EdgePosition>> res(threads);
-    std::function<void(size_t, Edge &)> task = [&res, w, this](size_t pos, Edge &edge) {
+    ParallelRecordCollector<std::pair<AnchorIndex::key_type, EdgePosition>> res(threads);
+    std::function<void(size_t, Edge &)> task = [&res, w, this, &to_add](size_t pos, Edge &edge) {
         Vertex &vertex = *edge.start();
-        if (edge.size() > w) {
+        if (edge.size() > w || !to_add.empty()) {
             Sequence seq = vertex.seq + edge.seq;
 //                    Does not run for the first and last kmers.
             for (hashing::KWH kmer(this->hasher_, seq, 1); kmer.hasNext(); kmer = kmer.next()) {
-                if (kmer.pos % w == 0) {
+                if (kmer.pos % w == 0 || (!to_add.empty() && to_add.find(kmer.hash()) != to_add.end())) {
                     EdgePosition ep(edge, kmer.pos);
                     if (kmer.isCanonical())
                         res.emplace_back(kmer.hash(), ep);
@@ -613,23 +754,22 @@ void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads) {
         }
     };
     processObjects(edges().begin(), edges().end(), logger, threads, task);
-    for (auto &tmp : res) {
-        anchors.emplace(tmp);
-    }
-    logger.trace() << "Added " << anchors.size() << " anchors" << std::endl;
+    anchors.insertAll(res.collect(), threads);
+    logger.trace() << "Added " << anchors.size() << " anchors. Anchor index takes " <<
+                   anchors.memoryUsage() / 1024 / 1024 << "Mb" << std::endl;
 }
 
-void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads,
-                            const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &to_add) {
-    logger.trace() << "Adding anchors from long edges for alignment" << std::endl;
+void SparseDBG::updateAnchors(const std::vector<Vertex *> &vertices, size_t w, logging::Logger &logger, size_t threads) {
+    logger.trace() << "Updating anchors on edges of " << vertices.size() << " vertices" << std::endl;
+    for (Vertex *vertex : vertices) {
+        anchors.erase(vertex->hash());
+    }
     ParallelRecordCollector<std::pair<const hashing::htype, EdgePosition>> res(threads);
-    std::function<void(size_t, Edge &)> task = [&res, w, this, &to_add](size_t pos, Edge &edge) {
-        Vertex &vertex = *edge.start();
-        if (edge.size() > w || !to_add.empty()) {
-            Sequence seq = vertex.seq + edge.seq;
-//                    Does not run for the first and last kmers.
+    std::function<void(size_t, Vertex *&)> task = [&res, w, this](size_t pos, Vertex *&vertex) {
+        for (Edge &edge : *vertex) {
+            Sequence seq = vertex->seq + edge.seq;
             for (hashing::KWH kmer(this->hasher_, seq, 1); kmer.hasNext(); kmer = kmer.next()) {
-                if (kmer.pos % w == 0 || to_add.find(kmer.hash()) != to_add.end()) {
+                if ((edge.size() > w && kmer.pos % w == 0) || anchors.contains(kmer.hash())) {
                     EdgePosition ep(edge, kmer.pos);
                     if (kmer.isCanonical())
                         res.emplace_back(kmer.hash(), ep);
@@ -640,32 +780,72 @@ void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads,
             }
         }
     };
-    processObjects(edges().begin(), edges().end(), logger, threads, task);
-    for (auto &tmp : res) {
-        anchors.emplace(tmp);
+    std::vector<Vertex *> tmp(vertices);
+    processObjects(tmp.begin(), tmp.end(), logger, threads, task);
+    for (auto &anchor : res) {
+        anchors.set(anchor.first, anchor.second);
     }
-    logger.trace() << "Added " << anchors.size() << " anchors" << std::endl;
 }
 
-EdgePosition SparseDBG::getAnchor(const hashing::KWH &kwh) {
-    if (kwh.isCanonical())
-        return anchors.find(kwh.hash())->second;
-    else
-        return anchors.find(kwh.hash())->second.RC();
+EdgePosition SparseDBG::findAnchor(const hashing::KWH &kwh) const {
+    EdgePosition res = anchors.find(kwh.hash());
+    if (res.edge == nullptr)
+        return res;
+    if (!kwh.isCanonical())
+        res = res.RC();
+#if defined(LJA_HASH64)
+    if (res.kmerSeq() != kwh.getSeq())
+        return {};
+#elif defined(LJA_DEBUG)
+    VERIFY_MSG(res.kmerSeq() == kwh.getSeq(), "Hash collision of anchor k-mer");
+#endif
+    return res;
+}
+
+bool SparseDBG::isVertexKmer(const hashing::KWH &kwh) const {
+    const Vertex &vertex = v.find(kwh.hash())->second;
+    if (!vertex.seq_filled_.load(std::memory_order_acquire))
+        return true;
+    return kwh.isCanonical() ? vertex.seq == kwh.getSeq() : vertex.seq == !kwh.getSeq();
 }
 
 std::vector<hashing::KWH> SparseDBG::extractVertexPositions(const Sequence &seq, size_t max) const {
     std::vector<hashing::KWH> res;
-    hashing::KWH kwh(hasher(), seq, 0);
-    while (true) {
-        if (containsVertex(kwh.hash())) {
-            res.emplace_back(kwh);
+    extractVertexPositions(seq, res, max);
+    return std::move(res);
+}
+
+void SparseDBG::extractVertexPositions(const Sequence &seq, std::vector<hashing::KWH> &res, size_t max) const {
+#ifdef LJA_HASH64
+    collectVertexPositions(seq, res, max, true);
+#else
+    collectVertexPositions(seq, res, max, false);
+#endif
+}
+
+void SparseDBG::collectVertexPositions(const Sequence &seq, std::vector<hashing::KWH> &res, size_t max, bool check_kmers) const {
+    res.clear();
+//    Hashes are computed for a block of positions and index slots of the whole block are prefetched before the lookups
+    constexpr size_t block = 32;
+    hashing::htype fhashes[block];
+    hashing::htype rhashes[block];
+    hashing::htype hashes[block];
+    hashing::KmerHashStream stream(hasher(), seq);
+    while (stream.hasNext() && res.size() < max) {
+        size_t from = stream.position();
+        size_t cnt = stream.next(fhashes, rhashes, block);
+        for (size_t i = 0; i < cnt; i++) {
+            hashes[i] = std::min(fhashes[i], rhashes[i]);
+            v.prefetch(hashes[i]);
+        }
+        for (size_t i = 0; i < cnt && res.size() < max; i++) {
+            if (containsVertex(hashes[i])) {
+                res.emplace_back(stream.kwh(from + i, fhashes[i], rhashes[i]));
+                if (check_kmers && !isVertexKmer(res.back()))
+                    res.pop_back();
+            }
         }
-        if (!kwh.hasNext() || res.size() == max)
-            break;
-        kwh = kwh.next();
     }
-    return std::move(res);
 }
 
 void SparseDBG::printFastaOld(const std::experimental::filesystem::path &out) {
@@ -678,8 +858,231 @@ void SparseDBG::printFastaOld(const std::experimental::filesystem::path &out) {
     os.close();
 }
 
+namespace {
+//    Snapshot layout: header, vertex records, anchor records, edge records and packed sequence words.
+//    Vertex references store vertex index shifted by one with the lowest bit set for the rc vertex.
+//    Edges of each vertex are stored in outgoing order, first for the vertex and then for its rc.
+//    Only one edge of each rc pair keeps its sequence. The other one refers to its pair by index.
+    const char snapshot_magic[8] = {'L', 'J', 'A', 'S', 'D', 'B', 'G', '1'};
+    const uint64_t no_vertex = uint64_t(-1);
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint64_t k;
+        uint64_t vertices;
+        uint64_t anchors;
+        uint64_t edges;
+        uint64_t words;
+        uint64_t hash_size;
+        uint64_t reserved;
+    };
+
+    struct SnapshotVertex {
+        hashing::htype hash;
+        uint64_t coverage;
+        uint64_t rc_coverage;
+        uint32_t out_deg;
+        uint32_t rc_out_deg;
+        uint64_t seq_offset;
+    };
+
+    struct SnapshotAnchor {
+        hashing::htype hash;
+        uint64_t vertex;
+        uint64_t edge;
+        uint64_t pos;
+        uint64_t reserved;
+    };
+
+    struct SnapshotEdge {
+        uint64_t end;
+        uint64_t cov;
+        uint64_t size;
+//        Offset of packed sequence or index of the rc edge among outgoing edges of end->rc()
+        uint64_t data;
+        uint64_t flags;
+        uint64_t reserved;
+    };
+
+    const uint64_t edge_reliable = 1u;
+    const uint64_t edge_rc_stored = 2u;
+
+    template<class T>
+    void writeRecords(std::ostream &os, const std::vector<T> &records) {
+        os.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+    }
+}
+
+void SparseDBG::saveSnapshot(const std::experimental::filesystem::path &out, logging::Logger &logger, bool save_anchors) {
+    logger.trace() << "Saving graph snapshot to " << out << std::endl;
+    std::vector<Vertex *> vertex_list;
+    vertex_list.reserve(v.size());
+    std::unordered_map<const Vertex *, uint64_t> vertex_ids;
+    vertex_ids.reserve(v.size() * 2);
+    for(auto &it : v) {
+        Vertex &vertex = it.second;
+        vertex_ids[&vertex] = vertex_list.size() << 1u;
+        vertex_ids[&vertex.rc()] = (vertex_list.size() << 1u) | 1u;
+        vertex_list.push_back(&vertex);
+    }
+    std::vector<SnapshotVertex> vertex_records;
+    std::vector<SnapshotEdge> edge_records;
+    std::vector<uint64_t> words;
+    vertex_records.reserve(vertex_list.size());
+    for(Vertex *vertex : vertex_list) {
+        VERIFY(vertex->outDeg() < (size_t(1) << 32u) && vertex->inDeg() < (size_t(1) << 32u));
+        vertex_records.push_back({vertex->hash(), vertex->coverage_, vertex->rc().coverage_,
+                                  uint32_t(vertex->outDeg()), uint32_t(vertex->inDeg()), words.size()});
+        vertex->seq.writePacked(words);
+        for(Vertex *start : {vertex, &vertex->rc()}) {
+            for(Edge &edge : *start) {
+                SnapshotEdge rec = {no_vertex, edge.intCov(), edge.size(), 0, edge.is_reliable ? edge_reliable : 0, 0};
+                if(edge.end() != nullptr)
+                    rec.end = vertex_ids[edge.end()];
+                if(edge.end() == nullptr || start->isCanonical(edge)) {
+                    rec.data = words.size();
+                    edge.seq.writePacked(words);
+                } else {
+                    Edge &rc_edge = edge.rc();
+                    rec.data = &rc_edge - &rc_edge.start()->outgoing_.front();
+                    rec.flags |= edge_rc_stored;
+                }
+                edge_records.push_back(rec);
+            }
+        }
+    }
+    std::vector<SnapshotAnchor> anchor_records;
+    if(save_anchors) {
+        anchor_records.reserve(anchors.size());
+        anchors.forEach([&anchor_records, &vertex_ids](AnchorIndex::key_type key, const EdgePosition &ep) {
+            Vertex &start = *ep.edge->start();
+            anchor_records.push_back({key, vertex_ids[&start], uint64_t(ep.edge - &start.outgoing_.front()), ep.pos, 0});
+        });
+    }
+    SnapshotHeader header = {};
+    std::copy(snapshot_magic, snapshot_magic + 8, header.magic);
+    header.k = hasher_.getK();
+    header.vertices = vertex_records.size();
+    header.anchors = anchor_records.size();
+    header.edges = edge_records.size();
+    header.words = words.size();
+    header.hash_size = sizeof(hashing::htype);
+    std::ofstream os(out, std::ios::binary);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeRecords(os, vertex_records);
+    writeRecords(os, anchor_records);
+    writeRecords(os, edge_records);
+    writeRecords(os, words);
+    os.close();
+    VERIFY_MSG(!os.fail(), "Failed to write graph snapshot to " + out.string());
+    logger.trace() << "Saved " << header.vertices << " vertices, " << header.edges << " edges and " << header.anchors <<
+                   " anchors to snapshot" << std::endl;
+}
+
+SparseDBG SparseDBG::loadSnapshot(const std::experimental::filesystem::path &in, const hashing::RollingHash &hasher,
+                                  logging::Logger &logger, size_t threads) {
+    logger.info() << "Loading graph snapshot from " << in << std::endl;
+    int fd = open(in.c_str(), O_RDONLY);
+    VERIFY_MSG(fd >= 0, "Failed to open graph snapshot " + in.string());
+    struct stat st = {};
+    VERIFY(fstat(fd, &st) == 0);
+    size_t file_size = st.st_size;
+    VERIFY_MSG(file_size >= sizeof(SnapshotHeader), "Graph snapshot is truncated");
+    void *map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    VERIFY_MSG(map != MAP_FAILED, "Failed to map graph snapshot " + in.string());
+    const auto *header = static_cast<const SnapshotHeader *>(map);
+    VERIFY_MSG(std::equal(snapshot_magic, snapshot_magic + 8, header->magic), "Incorrect graph snapshot format");
+    VERIFY_MSG(header->k == hasher.getK(), "Graph snapshot was constructed for different k");
+    VERIFY_MSG(header->hash_size == sizeof(hashing::htype), "Graph snapshot was constructed with different hash width");
+    VERIFY_MSG(file_size == sizeof(SnapshotHeader) + header->vertices * sizeof(SnapshotVertex) +
+               header->anchors * sizeof(SnapshotAnchor) + header->edges * sizeof(SnapshotEdge) +
+               header->words * sizeof(uint64_t), "Graph snapshot is truncated");
+    const auto *vertex_records = reinterpret_cast<const SnapshotVertex *>(header + 1);
+    const auto *anchor_records = reinterpret_cast<const SnapshotAnchor *>(vertex_records + header->vertices);
+    const auto *edge_records = reinterpret_cast<const SnapshotEdge *>(anchor_records + header->anchors);
+    const auto *words = reinterpret_cast<const uint64_t *>(edge_records + header->edges);
+    size_t k = hasher.getK();
+
+    std::vector<hashing::htype> hashes(header->vertices);
+    std::vector<size_t> edge_offsets(header->vertices + 1, 0);
+    for(size_t i = 0; i < header->vertices; i++) {
+        hashes[i] = vertex_records[i].hash;
+        edge_offsets[i + 1] = edge_offsets[i] + vertex_records[i].out_deg + vertex_records[i].rc_out_deg;
+    }
+    VERIFY_MSG(edge_offsets.back() == header->edges, "Inconsistent graph snapshot");
+    SparseDBG res(hashes, hasher, threads);
+    std::vector<Vertex *> vertex_list;
+    vertex_list.reserve(header->vertices);
+    for(auto &it : res.v) {
+        vertex_list.push_back(&it.second);
+    }
+    if(!vertex_list.empty())
+        VERIFY_MSG(hashing::KWH(hasher, Sequence::FromPacked(words + vertex_records[0].seq_offset, k), 0).hash() == hashes[0],
+                   "Graph snapshot was constructed with different hash function");
+    std::function<Vertex *(uint64_t)> get = [&vertex_list](uint64_t id) -> Vertex * {
+        if(id == no_vertex)
+            return nullptr;
+        Vertex *vertex = vertex_list[id >> 1u];
+        return (id & 1u) ? &vertex->rc() : vertex;
+    };
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(header, vertex_records, edge_records, words, vertex_list, edge_offsets, get, k, res) schedule(dynamic, 1024)
+    for(size_t i = 0; i < header->vertices; i++) {
+        Vertex &vertex = *vertex_list[i];
+        const SnapshotVertex &rec = vertex_records[i];
+        vertex.seq = res.arena_.copyPacked(words + rec.seq_offset, k);
+        vertex.rc().seq = !vertex.seq;
+        vertex.seq_filled_ = true;
+        vertex.rc().seq_filled_ = true;
+        vertex.coverage_ = rec.coverage;
+        vertex.rc().coverage_ = rec.rc_coverage;
+        vertex.outgoing_.reserve(rec.out_deg);
+        vertex.rc().outgoing_.reserve(rec.rc_out_deg);
+        for(size_t j = edge_offsets[i]; j < edge_offsets[i + 1]; j++) {
+            const SnapshotEdge &edge_rec = edge_records[j];
+            Vertex &start = j < edge_offsets[i] + rec.out_deg ? vertex : vertex.rc();
+            Sequence seq;
+            if(!(edge_rec.flags & edge_rc_stored))
+                seq = res.arena_.copyPacked(words + edge_rec.data, edge_rec.size);
+            start.outgoing_.emplace_back(&start, get(edge_rec.end), seq);
+            Edge &edge = start.outgoing_.back();
+            edge.incCov(edge_rec.cov);
+            edge.is_reliable = (edge_rec.flags & edge_reliable) != 0;
+        }
+    }
+//    Second pass restores sequences of edges that were stored through their rc pair
+#pragma omp parallel for default(none) shared(header, vertex_records, edge_records, vertex_list, edge_offsets, k, res) schedule(dynamic, 1024)
+    for(size_t i = 0; i < header->vertices; i++) {
+        Vertex &vertex = *vertex_list[i];
+        for(size_t j = edge_offsets[i]; j < edge_offsets[i + 1]; j++) {
+            const SnapshotEdge &edge_rec = edge_records[j];
+            if(!(edge_rec.flags & edge_rc_stored))
+                continue;
+            bool rc_side = j >= edge_offsets[i] + vertex_records[i].out_deg;
+            size_t ind = rc_side ? j - edge_offsets[i] - vertex_records[i].out_deg : j - edge_offsets[i];
+            Edge &edge = (rc_side ? vertex.rc() : vertex)[ind];
+            const Edge &rc_edge = edge.end()->rc()[edge_rec.data];
+            edge.seq = res.arena_.copy((!(rc_edge.start()->seq + rc_edge.seq)).Subseq(k));
+        }
+    }
+    std::vector<std::pair<AnchorIndex::key_type, EdgePosition>> anchor_values;
+    anchor_values.reserve(header->anchors);
+    for(size_t i = 0; i < header->anchors; i++) {
+        const SnapshotAnchor &rec = anchor_records[i];
+        anchor_values.emplace_back(rec.hash, EdgePosition((*get(rec.vertex))[rec.edge], rec.pos));
+    }
+    res.anchors.insertAll(std::move(anchor_values), threads);
+    logger.info() << "Loaded " << res.size() << " vertices, " << header->edges << " edges and " << header->anchors <<
+                  " anchors from snapshot" << std::endl;
+    munmap(map, file_size);
+    return std::move(res);
+}
+
 void SparseDBG::processRead(const Sequence &seq) {
-    std::vector<hashing::KWH> kmers = extractVertexPositions(seq);
+//    K-mers are not checked here since vertex sequences are being filled. Collisions are caught by setSequence instead.
+    std::vector<hashing::KWH> kmers;
+    collectVertexPositions(seq, kmers, size_t(-1), false);
     if (kmers.size() == 0) {
         std::cout << seq << std::endl;
     }
@@ -688,7 +1091,7 @@ void SparseDBG::processRead(const Sequence &seq) {
     for (size_t i = 0; i < kmers.size(); i++) {
         vertices.emplace_back(&getVertex(kmers[i]));
         if (i == 0 || vertices[i] != vertices[i - 1]) {
-            vertices.back()->setSequence(kmers[i].getSeq());
+            vertices.back()->setSequence(kmers[i].getSeq(), arena_);
             vertices.back()->incCoverage();
         }
     }
@@ -700,21 +1103,26 @@ void SparseDBG::processRead(const Sequence &seq) {
             kmers[i + 1].pos - kmers[i].pos < hasher_.getK()) {
             continue;
         }
-        vertices[i]->addEdge(Edge(vertices[i], vertices[i + 1], Sequence(seq.Subseq(kmers[i].pos + hasher_.getK(),
-                                                                                    kmers[i + 1].pos +
-                                                                                    hasher_.getK()).str())));
-        vertices[i + 1]->rc().addEdge(Edge(&vertices[i + 1]->rc(), &vertices[i]->rc(),
-                                           !Sequence(seq.Subseq(kmers[i].pos, kmers[i + 1].pos).str())));
+        vertices[i]->stageEdge(vertices[i + 1], seq.Subseq(kmers[i].pos + hasher_.getK(), kmers[i + 1].pos + hasher_.getK()), arena_);
+        vertices[i + 1]->rc().stageEdge(&vertices[i]->rc(), !seq.Subseq(kmers[i].pos, kmers[i + 1].pos), arena_);
     }
     if (kmers.front().pos > 0) {
-        vertices.front()->rc().addEdge(Edge(&vertices.front()->rc(), nullptr, !(seq.Subseq(0, kmers[0].pos))));
+        vertices.front()->rc().stageEdge(nullptr, !(seq.Subseq(0, kmers[0].pos)), arena_);
     }
     if (kmers.back().pos + hasher_.getK() < seq.size()) {
-        vertices.back()->addEdge(
-                Edge(vertices.back(), nullptr, seq.Subseq(kmers.back().pos + hasher_.getK(), seq.size())));
+        vertices.back()->stageEdge(nullptr, seq.Subseq(kmers.back().pos + hasher_.getK(), seq.size()), arena_);
     }
 }
 
+void SparseDBG::publishStagedEdges(logging::Logger &logger, size_t threads) {
+    std::function<void(size_t, std::pair<const hashing::htype, VertexPair> &)> task =
+            [](size_t pos, std::pair<const hashing::htype, VertexPair> &pair) {
+                pair.second.publishStagedEdges();
+                pair.second.rc().publishStagedEdges();
+            };
+    processObjects(v.begin(), v.end(), logger, threads, task);
+}
+
 //This method does not add rc edges so should be run for both edge and its rc
 void SparseDBG::processEdge(Vertex &vertex, Sequence old_seq) {
     Sequence seq = vertex.seq + old_seq;
@@ -759,9 +1167,67 @@ void SparseDBG::processEdge(Edge &other_graph_edge) {
     }
 }
 
+std::vector<Edge *> SparseDBG::edgesThrough(const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &hashes,
+                                         logging::Logger &logger, size_t threads) {
+    if(hashes.empty())
+        return {};
+    ParallelRecordCollector<Edge *> res(threads);
+    std::function<void(size_t, std::pair<const hashing::htype, VertexPair> &)> task =
+            [this, &hashes, &res](size_t pos, std::pair<const hashing::htype, VertexPair> &pair) {
+                for (Vertex *vertex : {static_cast<Vertex *>(&pair.second), &pair.second.rc()}) {
+                    for (Edge &edge : *vertex) {
+                        if (edge.size() < 2)
+                            continue;
+                        Sequence seq = vertex->seq + edge.seq;
+                        for (hashing::KWH kwh(hasher_, seq, 1); kwh.pos < edge.size(); kwh = kwh.next()) {
+                            if (hashes.find(kwh.hash()) != hashes.end()) {
+                                res.add(&edge);
+                                break;
+                            }
+                        }
+                    }
+                }
+            };
+    processObjects(v.begin(), v.end(), logger, threads, task);
+    return res.collect();
+}
+
+void SparseDBG::splitEdges(const std::vector<Edge *> &edges, logging::Logger &logger, size_t threads) {
+    std::vector<std::pair<Vertex *, Sequence>> old_edges;
+    old_edges.reserve(edges.size());
+    for (Edge *edge : edges) {
+        old_edges.emplace_back(edge->start(), edge->seq);
+    }
+    std::sort(old_edges.begin(), old_edges.end(),
+              [](const std::pair<Vertex *, Sequence> &a, const std::pair<Vertex *, Sequence> &b) {return a.first < b.first;});
+//    Edges are removed per start vertex so that every vertex is changed by one thread only
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = 0; i < old_edges.size(); i++) {
+        if (i == 0 || old_edges[i].first != old_edges[i - 1].first)
+            groups.emplace_back(i, i);
+        groups.back().second = i + 1;
+    }
+    std::function<void(size_t, std::pair<size_t, size_t> &)> remove_task =
+            [&old_edges](size_t pos, std::pair<size_t, size_t> &group) {
+                old_edges[group.first].first->removeOutgoingIf([&old_edges, &group](const Edge &edge) {
+                    for (size_t i = group.first; i < group.second; i++) {
+                        if (edge.seq == old_edges[i].second)
+                            return true;
+                    }
+                    return false;
+                });
+            };
+    processObjects(groups.begin(), groups.end(), logger, threads, remove_task);
+    std::function<void(size_t, std::pair<Vertex *, Sequence> &)> insert_task =
+            [this](size_t pos, std::pair<Vertex *, Sequence> &edge) {
+                processEdge(*edge.first, edge.second);
+            };
+    processObjects(old_edges.begin(), old_edges.end(), logger, threads, insert_task);
+}
+
 IterableStorage<ApplyingIterator<SparseDBG::vertex_iterator_type, Vertex, 2>> SparseDBG::vertices(bool unique) {
-    std::function<std::array<Vertex*, 2>(std::pair<const hashing::htype, Vertex> &)> apply =
-            [unique](std::pair<const hashing::htype, Vertex> &it) -> std::array<Vertex*, 2> {
+    std::function<std::array<Vertex*, 2>(std::pair<const hashing::htype, VertexPair> &)> apply =
+            [unique](std::pair<const hashing::htype, VertexPair> &it) -> std::array<Vertex*, 2> {
                 if(unique)
                     return {&it.second};
                 else
@@ -777,7 +1243,7 @@ IterableStorage<ApplyingIterator<SparseDBG::vertex_iterator_type, Vertex, 2>> Sp
 }
 
 IterableStorage<ApplyingIterator<SparseDBG::vertex_iterator_type, Edge, 8>> SparseDBG::edges(bool unique) {
-    std::function<std::array<Edge*, 8>(const std::pair<const hashing::htype, Vertex> &)> apply = [unique](const std::pair<const hashing::htype, Vertex> &it) {
+    std::function<std::array<Edge*, 8>(const std::pair<const hashing::htype, VertexPair> &)> apply = [unique](const std::pair<const hashing::htype, VertexPair> &it) {
         std::array<Edge*, 8> res = {};
         size_t cur = 0;
         for(Edge &edge : it.second) {
@@ -804,8 +1270,6 @@ IterableStorage<ApplyingIterator<SparseDBG::vertex_iterator_type, Edge, 8>> Spar
 }
 
 void SparseDBG::removeIsolated() {
-    vertex_map_type newv;
-    std::vector<hashing::htype> todelete;
     for (auto it = v.begin(); it != v.end();) {
         if (it->second.outDeg() == 0 && it->second.inDeg() == 0) {
             it = v.erase(it);
@@ -815,14 +1279,11 @@ void SparseDBG::removeIsolated() {
     }
 }
 
-void SparseDBG::removeMarked() {
-    for (auto it = v.begin(); it != v.end();) {
-        if (it->second.marked() || (it->second.inDeg() == 0 && it->second.outDeg() == 0)) {
-            it = v.erase(it);
-        } else {
-            ++it;
-        }
-    }
+size_t SparseDBG::removeMarked(size_t threads) {
+    return v.eraseIf([](const std::pair<const hashing::htype, VertexPair> &pair) {
+        const Vertex &vert = pair.second;
+        return vert.marked() || (vert.inDeg() == 0 && vert.outDeg() == 0);
+    }, threads);
 }
 
 //const Vertex &SparseDBG::getVertex(const hashing::KWH &kwh) const {
@@ -11,6 +11,9 @@
 #include "common/hash_utils.hpp"
 #include <common/oneline_utils.hpp>
 #include <common/iterator_utils.hpp>
+#include <common/chunked_hash_map.hpp>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <numeric>
 #include <unordered_map>
@@ -21,6 +24,8 @@ namespace dbg {
 
     class SparseDBG;
 
+    class FrozenDBG;
+
     class Edge {
     private:
         Vertex *start_;
@@ -69,19 +74,42 @@ namespace dbg {
 
     class Vertex {
     private:
+//        Edges added by processRead before they are published. Each outgoing nucleotide has its own slot with a list of
+//        branches since reads with errors may diverge after the first nucleotide. New branches are appended to the end of
+//        the list so that frequent early branches are checked first. When a branch is extended by a longer edge, the longer
+//        version is appended to its chain and the previous version stays readable until publishing.
+//        A staged edge is linked before its sequence is copied, so that only the thread that won the slot copies it.
+//        Other threads wait for ready before they compare with it.
+        struct StagedEdge {
+            Edge edge;
+            std::atomic<StagedEdge *> next{nullptr};
+            std::atomic<StagedEdge *> longer{nullptr};
+            std::atomic<bool> ready{false};
+            StagedEdge(Vertex *start, Vertex *end) : edge(start, end, Sequence()) {}
+            const Sequence &waitSeq() const {
+                while(!ready.load(std::memory_order_acquire));
+                return edge.seq;
+            }
+        };
+        struct StagedEdges {
+            std::atomic<StagedEdge *> slots[4] = {};
+        };
+
         friend class SparseDBG;
+        friend class VertexPair;
         mutable std::vector<Edge> outgoing_{};
         Vertex *rc_;
         hashing::htype hash_;
         omp_lock_t writelock = {};
         size_t coverage_ = 0;
+        std::atomic<StagedEdges *> staged_{nullptr};
         bool canonical = false;
         bool mark_ = false;
-        explicit Vertex(hashing::htype hash, Vertex *_rc);
+        std::atomic<bool> seq_filled_{false};
+        Vertex(hashing::htype hash, Vertex *_rc, bool _canonical);
     public:
         Sequence seq;
 
-        explicit Vertex(hashing::htype hash = 0);
         Vertex(const Vertex &) = delete;
         ~Vertex();
 
@@ -91,7 +119,8 @@ namespace dbg {
         hashing::htype hash() const {return hash_;}
         Vertex &rc() {return *rc_;}
         const Vertex &rc() const {return *rc_;}
-        void setSequence(const Sequence &_seq);
+//        Packed copy of the first sequence is stored in arena. Reverse complement vertex shares the same buffer.
+        void setSequence(const Sequence &_seq, SequenceArena &arena);
         void lock() {omp_set_lock(&writelock);}
         void unlock() {omp_unset_lock(&writelock);}
         std::vector<Edge>::iterator begin() const {return outgoing_.begin();}
@@ -106,6 +135,11 @@ namespace dbg {
         bool isCanonical(const Edge &edge) const;
         void clear();
         void clearOutgoing();
+//        Removes outgoing edges satisfying the predicate. Edges of the reverse complement vertex are not changed.
+        template<class P>
+        void removeOutgoingIf(const P &pred) {
+            outgoing_.erase(std::remove_if(outgoing_.begin(), outgoing_.end(), pred), outgoing_.end());
+        }
         void sortOutgoing();
         void checkConsistency() const;
         std::string getId() const;
@@ -115,6 +149,10 @@ namespace dbg {
         void clearSequence();
         Edge &addEdgeLockFree(const Edge &edge);
         void addEdge(const Edge &e);
+//        Lock-free version of addEdge that copies seq to arena only after it won the slot against the edges already staged.
+//        Staged edges become visible only after publishStagedEdges.
+        void stageEdge(Vertex *end, const Sequence &seq, SequenceArena &arena);
+        void publishStagedEdges();
         Edge &getOutgoing(unsigned char c) const;
         bool hasOutgoing(unsigned char c) const;
         bool isJunction() const;
@@ -125,6 +163,15 @@ namespace dbg {
         bool operator>(const Vertex &other) const;
     };
 
+//    Canonical vertex together with its reverse complement twin. Graph stores both in one object so that the twin
+//    does not need a separate allocation. The twin's k-mer is a reverse complement view of the canonical one.
+    class VertexPair : public Vertex {
+    private:
+        Vertex twin_;
+    public:
+        explicit VertexPair(hashing::htype hash) : Vertex(hash, &twin_, true), twin_(hash, this, false) {}
+    };
+
     struct EdgePosition {
         Edge *edge;
         size_t pos;
@@ -140,27 +187,90 @@ namespace dbg {
         EdgePosition RC() const {return {edge->rc(), edge->size() - pos};}
     };
 
+//    Anchors stored inline in one flat linear probing table instead of separately allocated map nodes. Each slot also has
+//    one byte tag with 7 bits of the key in a separate array, so lookups of k-mers that are not anchors usually touch only
+//    the tag array. Anchors are keyed by the full canonical k-mer hash, so a found anchor belongs to the query k-mer
+//    unless the hashes of two k-mers collide.
+    class AnchorIndex {
+    public:
+        typedef hashing::htype key_type;
+    private:
+        struct Record {
+            key_type key;
+            Edge *edge;
+            uint32_t pos;
+        };
+//        Zero tag marks empty slot
+        std::vector<uint8_t> tags;
+        std::vector<Record> records;
+        size_t cnt = 0;
+
+        static uint64_t mix(key_type k) {return (uint64_t(k) ^ uint64_t(k >> 32u >> 32u)) * 0x9E3779B97F4A7C15ull;}
+        static uint8_t tag(key_type k) {return uint8_t(0x80u | ((mix(k) >> 25u) & 0x7fu));}
+        size_t home(key_type k) const {return size_t((unsigned __int128)mix(k) * tags.size() >> 64u);}
+        size_t next(size_t slot) const {return slot + 1 == tags.size() ? 0 : slot + 1;}
+//        Slot that contains the key or empty slot where it should be inserted
+        size_t findSlot(key_type k) const {
+            uint8_t t = tag(k);
+            size_t slot = home(k);
+            while(tags[slot] != 0 && (tags[slot] != t || records[slot].key != k))
+                slot = next(slot);
+            return slot;
+        }
+//        Inserts records with unique keys that are not present in the table. Table should have enough free slots.
+        void insertConcurrent(const std::vector<Record> &values, size_t threads);
+        void rehash(size_t n, size_t threads);
+    public:
+        size_t size() const {return cnt;}
+        size_t memoryUsage() const {return tags.capacity() + records.capacity() * sizeof(Record);}
+        bool contains(hashing::htype hash) const {return cnt > 0 && tags[findSlot(hash)] != 0;}
+//        Returns empty position if there is no anchor with this key
+        EdgePosition find(hashing::htype hash) const {
+            if(cnt == 0)
+                return {};
+            size_t slot = findSlot(hash);
+            return tags[slot] == 0 ? EdgePosition() : EdgePosition(*records[slot].edge, records[slot].pos);
+        }
+//        Does not replace existing anchor
+        void emplace(hashing::htype hash, const EdgePosition &ep);
+        void set(hashing::htype hash, const EdgePosition &ep);
+        void erase(hashing::htype hash);
+//        Adds anchors in parallel. Anchors with keys that are already present are skipped, duplicates are added once.
+        void insertAll(std::vector<std::pair<key_type, EdgePosition>> &&values, size_t threads);
+        template<class F>
+        void forEach(const F &f) const {
+            for(size_t slot = 0; slot < tags.size(); slot++)
+                if(tags[slot] != 0)
+                    f(records[slot].key, EdgePosition(*records[slot].edge, records[slot].pos));
+        }
+    };
+
     class SparseDBG {
     public:
-        typedef std::unordered_map<hashing::htype , Vertex, hashing::alt_hasher<hashing::htype>> vertex_map_type;
-        typedef std::unordered_map<hashing::htype, Vertex, hashing::alt_hasher<hashing::htype>>::iterator vertex_iterator_type;
-        typedef std::unordered_map<hashing::htype, EdgePosition, hashing::alt_hasher<hashing::htype>> anchor_map_type;
+        typedef ChunkedHashMap<hashing::htype, VertexPair, hashing::alt_hasher<hashing::htype>> vertex_map_type;
+        typedef vertex_map_type::iterator vertex_iterator_type;
+//    Index used for vertex storage of newly created graphs. Open addressing is default, chained is the old unordered_map behaviour.
+        static HashIndexType vertex_index_type;
     private:
-//    TODO: replace with perfect hash map? It is parallel, maybe faster and compact.
         vertex_map_type v;
-        anchor_map_type anchors;
+        AnchorIndex anchors;
         hashing::RollingHash hasher_;
+//    Storage for vertex k-mers and edge sequences copied from reads
+        SequenceArena arena_;
 
 //    Be careful since hash does not define vertex. Rc vertices share the same hash
         Vertex &innerAddVertex(hashing::htype h) {
-            return v.emplace(std::piecewise_construct, std::forward_as_tuple(h),
-                             std::forward_as_tuple(h)).first->second;
+            return v.emplace(h, h).first->second;
         }
+//    With 64-bit hashes a k-mer may share its hash with a different vertex k-mer. Vertices whose sequence is not set yet
+//    can not be checked and are accepted.
+        bool isVertexKmer(const hashing::KWH &kwh) const;
+        void collectVertexPositions(const Sequence &seq, std::vector<hashing::KWH> &res, size_t max, bool check_kmers) const;
 
     public:
 
         template<class Iterator>
-        SparseDBG(Iterator begin, Iterator end, hashing::RollingHash _hasher) : hasher_(_hasher) {
+        SparseDBG(Iterator begin, Iterator end, hashing::RollingHash _hasher) : v(vertex_index_type), hasher_(_hasher) {
             while (begin != end) {
                 hashing::htype hash = *begin;
                 if (v.find(hash) == v.end())
@@ -168,14 +278,20 @@ namespace dbg {
                 ++begin;
             }
         }
-        explicit SparseDBG(hashing::RollingHash _hasher) : hasher_(_hasher) {}
+//    Bulk construction from a list of unique vertex hashes in any order. Vertex storage is filled in parallel and vertices
+//    are iterated in the order of the list.
+        SparseDBG(const std::vector<hashing::htype> &hashes, hashing::RollingHash _hasher, size_t threads) :
+                v(vertex_index_type), hasher_(_hasher) {
+            v.bulkEmplace(hashes, threads);
+        }
+        explicit SparseDBG(hashing::RollingHash _hasher) : v(vertex_index_type), hasher_(_hasher) {}
         SparseDBG(SparseDBG &&other) = default;
         SparseDBG &operator=(SparseDBG &&other) = default;
         SparseDBG(const SparseDBG &other) noexcept = delete;
 
         SparseDBG Subgraph(std::vector<Segment<Edge>> &pieces);
-        SparseDBG SplitGraph(const std::vector<EdgePosition> &breaks);
-        SparseDBG AddNewSequences(logging::Logger &logger, size_t threads, const std::vector<Sequence> &new_seqs);
+//    Splits edges in place at given positions. Positions at edge borders are ignored. Anchors are not updated.
+        void splitEdgesAt(const std::vector<EdgePosition> &breaks, logging::Logger &logger, size_t threads);
 
         const hashing::RollingHash &hasher() const {return hasher_;}
         bool containsVertex(const hashing::htype &hash) const {return v.find(hash) != v.end();}
@@ -185,21 +301,36 @@ namespace dbg {
         Vertex &getVertex(const Vertex &other_graph_vertex);
         std::array<Vertex *, 2> getVertices(hashing::htype hash);
 //        const Vertex &getVertex(const hashing::KWH &kwh) const;
-        bool isAnchor(hashing::htype hash) const {return anchors.find(hash) != anchors.end();}
-        EdgePosition getAnchor(const hashing::KWH &kwh);
+        bool isAnchor(hashing::htype hash) const {return anchors.contains(hash);}
+//    Position of anchor k-mer in the orientation of kwh. Returns empty position if kwh is not an anchor.
+        EdgePosition findAnchor(const hashing::KWH &kwh) const;
+        size_t anchorIndexMemory() const {return anchors.memoryUsage();}
         size_t size() const {return v.size();}
+        size_t vertexIndexMemory() const {return v.memoryUsage();}
 
         void checkConsistency(size_t threads, logging::Logger &logger);
         void checkDBGConsistency(size_t threads, logging::Logger &logger);
         void checkSeqFilled(size_t threads, logging::Logger &logger);
         void fillAnchors(size_t w, logging::Logger &logger, size_t threads);
         void fillAnchors(size_t w, logging::Logger &logger, size_t threads, const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &to_add);
+//    Edges are staged without locks and should be published with publishStagedEdges after all reads are processed
         void processRead(const Sequence &seq);
+        void publishStagedEdges(logging::Logger &logger, size_t threads);
         void processEdge(Vertex &vertex, Sequence old_seq);
         void processEdge(Edge &other_graph_edge);
+//    Edges that contain any of the given k-mers strictly inside. Both orientations of such edges are reported.
+        std::vector<Edge *> edgesThrough(const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &hashes,
+                                         logging::Logger &logger, size_t threads);
+//    Removes given edges and inserts them again so that they are split at vertices added after the edges were created.
+//    Both orientations of each edge should be given. Coverage of split edges is not preserved.
+        void splitEdges(const std::vector<Edge *> &edges, logging::Logger &logger, size_t threads);
+//    Updates anchors on outgoing edges of given vertices after these edges were changed in place. Anchors at vertex k-mers
+//    are removed and edges longer than w get anchors every w positions as in fillAnchors.
+        void updateAnchors(const std::vector<Vertex *> &vertices, size_t w, logging::Logger &logger, size_t threads);
         Vertex &bindTip(Vertex &start, Edge &tip);
         void removeIsolated();
-        void removeMarked();
+//        Removes marked and isolated vertices in parallel. Returns the number of removed vertex pairs.
+        size_t removeMarked(size_t threads = 1);
 
         void addVertex(hashing::htype h) {innerAddVertex(h);}
         Vertex &addVertex(const hashing::KWH &kwh);
@@ -207,8 +338,16 @@ namespace dbg {
         Vertex &addVertex(const Vertex &other_graph_vertex);
 
 
+//    In 64-bit hash builds positions whose k-mer differs from the vertex k-mer with the same hash are skipped
         std::vector<hashing::KWH> extractVertexPositions(const Sequence &seq, size_t max = size_t(-1)) const;
+//        Same as above but fills res reusing its memory
+        void extractVertexPositions(const Sequence &seq, std::vector<hashing::KWH> &res, size_t max = size_t(-1)) const;
         void printFastaOld(const std::experimental::filesystem::path &out);
+//    Binary snapshot of the graph with coverages, reliability flags and anchors. It is loaded through mmap and
+//    does not require hashing of edge sequences. Anchors should be skipped if the graph was modified after fillAnchors.
+        void saveSnapshot(const std::experimental::filesystem::path &out, logging::Logger &logger, bool save_anchors = true);
+        static SparseDBG loadSnapshot(const std::experimental::filesystem::path &in, const hashing::RollingHash &hasher,
+                                      logging::Logger &logger, size_t threads);
 
         IterableStorage<ApplyingIterator<vertex_iterator_type, Vertex, 2>> vertices(bool unique = false);
         IterableStorage<ApplyingIterator<vertex_iterator_type, Vertex, 2>> verticesUnique();
@@ -38,7 +38,7 @@ bool checkInner(dbg::Vertex &v) {
 void FillReliableWithConnections(logging::Logger &logger, dbg::SparseDBG &sdbg, double threshold) {
     logger.info() << "Marking reliable edges" << std::endl;
     for(auto &vit : sdbg) {
-        for(dbg::Vertex * vp : {&vit.second, &vit.second.rc()}) {
+        for(dbg::Vertex * vp : {static_cast<dbg::Vertex *>(&vit.second), &vit.second.rc()}) {
             dbg::Vertex &v = *vp;
             for(dbg::Edge &edge : v) {
                 edge.is_reliable = edge.getCoverage() >= threshold;
@@ -48,7 +48,7 @@ void FillReliableWithConnections(logging::Logger &logger, dbg::SparseDBG &sdbg,
     size_t cnt_paths = 0;
     std::vector<dbg::Edge *> new_reliable;
     for(auto &vit : sdbg) {
-        for(dbg::Vertex * vp : {&vit.second, &vit.second.rc()}) {
+        for(dbg::Vertex * vp : {static_cast<dbg::Vertex *>(&vit.second), &vit.second.rc()}) {
             dbg::Vertex &v = *vp;
             dbg::Edge *last = checkBorder(v);
             if(last == nullptr)
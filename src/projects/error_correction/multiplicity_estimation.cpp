@@ -64,7 +64,7 @@ size_t MappedNetwork::addTipSinks() {
 MultiplicityBoundsEstimator::MultiplicityBoundsEstimator(SparseDBG &dbg,
                                                          const AbstractUniquenessStorage &uniquenessStorage) : dbg(dbg){
     for(auto & it : dbg) {
-        for(auto v_it : {&it.second, &it.second.rc()}) {
+        for(auto v_it : {static_cast<Vertex *>(&it.second), &it.second.rc()}) {
             for(Edge &edge : *v_it) {
                 if (uniquenessStorage.isUnique(edge)) {
                     bounds.updateBounds(edge, 1, 1);
@@ -137,19 +137,23 @@ std::string constructMessage() {
     ss << "  -h (or --help)                                Print this help message.\n";
     ss << "\nAdvanced options:\n";
     ss << "  -t <int> (or --threads <int>)                 Number of threads. The default value is 16.\n";
+    ss << "  --decompression-threads <int>                 Number of threads that decompress BGZF compressed reads. It does not depend on --threads. The default value is 4.\n";
     ss << "  -w <int> (or --window <int>`)                 The window size to be used for sparse de Bruijn graph construction. The default value is 2000. Note that all reads of length less than k + w are ignored during graph construction.\n";
     ss << "  --compress                                    Compress all homolopymers in reads.\n";
     ss << "  --coverage                                    Calculate edge coverage of edges in the constructed de Bruijn graph.\n";
+    ss << "  --vertex-index <open|chained>                 Hash table used to store de Bruijn graph vertices. The default value is open.\n";
+    ss << "  --minimizer-memory <int>                      Memory limit in Gb for minimizer collection. Minimizers that do not fit are spilled to disk. The default value 0 means no limit.\n";
+    ss << "  --exact-junctions                             Find de Bruijn graph vertices by sorting all k-mers instead of using a bloom filter. Exact search takes more memory but creates no spurious vertices. Memory limit set by --minimizer-memory also applies to it.\n";
     return ss.str();
 }
 
 int main(int argc, char **argv) {
     CLParser parser({"vertices=none", "unique=none", "coverages=none", "dbg=none", "output-dir=",
-                     "threads=16", "k-mer-size=", "window=2000", "base=239", "debug", "disjointigs=none", "reference=none",
+                     "threads=16", "decompression-threads=4", "k-mer-size=", "window=2000", "base=239", "debug", "disjointigs=none", "reference=none",
                      "simplify", "coverage", "cov-threshold=2", "rel-threshold=10", "tip-correct",
                      "initial-correct", "mult-correct", "mult-analyse", "compress", "dimer-compress=1000000000,1000000000,1", "help", "genome-path",
                      "dump", "extension-size=none", "print-all", "extract-subdatasets", "print-alignments", "subdataset-radius=10000",
-                     "split", "diploid"},
+                     "split", "diploid", "vertex-index=open", "minimizer-memory=0", "exact-junctions"},
                     {"reads", "pseudo-reads", "align", "paths", "print-segment"},
                     {"h=help", "o=output-dir", "t=threads", "k=k-mer-size","w=window"},
                     constructMessage());
@@ -168,6 +172,9 @@ int main(int argc, char **argv) {
     bool debug = parser.getCheck("debug");
     StringContig::homopolymer_compressing = parser.getCheck("compress");
     StringContig::SetDimerParameters(parser.getValue("dimer-compress"));
+    dbg::SparseDBG::vertex_index_type = parseHashIndexType(parser.getValue("vertex-index"));
+    minimizer_memory_limit = std::stoull(parser.getValue("minimizer-memory")) << 30u;
+    exact_junctions = parser.getCheck("exact-junctions");
     const std::experimental::filesystem::path dir(parser.getValue("output-dir"));
     ensure_dir_existance(dir);
     logging::LoggerStorage ls(dir, "dbg");
@@ -200,6 +207,7 @@ int main(int argc, char **argv) {
     io::Library construction_lib = reads_lib + pseudo_reads_lib + genome_lib;
     size_t threads = std::stoi(parser.getValue("threads"));
     omp_set_num_threads(threads);
+    io::SeqReader::decompression_threads = std::stoull(parser.getValue("decompression-threads"));
 
     std::string disjointigs_file = parser.getValue("disjointigs");
     std::string vertices_file = parser.getValue("vertices");
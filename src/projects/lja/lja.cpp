@@ -156,6 +156,7 @@ std::vector<std::experimental::filesystem::path> NoCorrection(logging::Logger &l
             PrintPaths(logger, dir / "state_dump", "initial", dbg, readStorage, paths_lib, true);
         }
         dbg.printFastaOld(dir / "final_dbg.fasta");
+        dbg.saveSnapshot(dir / "final_dbg.sdbg", logger, false);
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
@@ -228,6 +229,7 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
             DrawSplit(Component(dbg), dir / "split_figs", readStorage.labeler());
         }
         dbg.printFastaOld(dir / "final_dbg.fasta");
+        dbg.saveSnapshot(dir / "final_dbg.sdbg", logger, false);
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
@@ -250,7 +252,11 @@ std::vector<std::experimental::filesystem::path> MDBGPhase(
     logger.info() << "Performing repeat resolution by transforming de Bruijn graph into Multiplex de Bruijn graph" << std::endl;
     std::function<void()> ic_task = [&logger, threads, debug, k, kmdbg, &graph_fasta, unique_threshold, diploid, &read_paths, &dir] {
         hashing::RollingHash hasher(k, 239);
-        SparseDBG dbg = dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
+        std::experimental::filesystem::path snapshot = graph_fasta;
+        snapshot.replace_extension(".sdbg");
+        SparseDBG dbg = std::experimental::filesystem::is_regular_file(snapshot) ?
+                SparseDBG::loadSnapshot(snapshot, hasher, logger, threads) :
+                dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
         size_t extension_size = 10000000;
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, debug);
@@ -306,15 +312,20 @@ std::string constructMessage() {
     ss << "  -h (or --help)                                Print this help message.\n";
     ss << "\nAdvanced options:\n";
     ss << "  -t <int> (or --threads <int>)                 Number of threads. The default value is 16.\n";
+    ss << "  --decompression-threads <int>                 Number of threads that decompress BGZF compressed reads. It does not depend on --threads. The default value is 4.\n";
     ss << "  -k <int>                                      Value of k used for initial error correction.\n";
     ss << "  -K <int>                                      Value of k used for final error correction and initialization of multiDBG.\n";
     ss << "  --diploid                                     Use this option for diploid genomes. By default LJA assumes that the genome is haploid or inbred.\n";
+    ss << "  --vertex-index <open|chained>                 Hash table used to store de Bruijn graph vertices. The default value is open.\n";
+    ss << "  --minimizer-memory <int>                      Memory limit in Gb for minimizer collection. Minimizers that do not fit are spilled to disk. The default value 0 means no limit.\n";
+    ss << "  --exact-junctions                             Find de Bruijn graph vertices by sorting all k-mers instead of using a bloom filter. Exact search takes more memory but creates no spurious vertices. Memory limit set by --minimizer-memory also applies to it.\n";
     return ss.str();
 }
 
 int main(int argc, char **argv) {
     CLParser parser({"output-dir=",
                      "threads=16",
+                     "decompression-threads=4",
                      "k-mer-size=501",
                      "window=2000",
                      "K-mer-size=5001",
@@ -327,6 +338,9 @@ int main(int argc, char **argv) {
                      "unique-threshold=40000",
                      "dump",
                      "dimer-compress=32,32,1",
+                     "vertex-index=open",
+                     "minimizer-memory=0",
+                     "exact-junctions",
                      "restart-from=none",
                      "load",
                      "noec",
@@ -358,6 +372,9 @@ int main(int argc, char **argv) {
     bool debug = parser.getCheck("debug");
     StringContig::homopolymer_compressing = true;
     StringContig::SetDimerParameters(parser.getValue("dimer-compress"));
+    dbg::SparseDBG::vertex_index_type = parseHashIndexType(parser.getValue("vertex-index"));
+    minimizer_memory_limit = std::stoull(parser.getValue("minimizer-memory")) << 30u;
+    exact_junctions = parser.getCheck("exact-junctions");
     const std::experimental::filesystem::path dir(parser.getValue("output-dir"));
     ensure_dir_existance(dir);
     logging::LoggerStorage ls(dir, "dbg");
@@ -377,6 +394,7 @@ int main(int argc, char **argv) {
     logger.info() << "LJA pipeline started" << std::endl;
 
     size_t threads = std::stoi(parser.getValue("threads"));
+    io::SeqReader::decompression_threads = std::stoull(parser.getValue("decompression-threads"));
 
     io::Library lib = oneline::initialize<std::experimental::filesystem::path>(parser.getListValue("reads"));
     io::Library paths = oneline::initialize<std::experimental::filesystem::path>(parser.getListValue("paths"));
@@ -392,9 +410,11 @@ int main(int argc, char **argv) {
     size_t KmDBG = std::stoi(parser.getValue("KmDBG"));
     size_t unique_threshold = std::stoi(parser.getValue("unique-threshold"));
 
+    io::Library cached_lib = first_stage == "none" || first_stage == "alternative" ?
+            io::CacheReads(lib, dir / "reads.rcache", logger) : lib;
     std::vector<std::experimental::filesystem::path> corrected_final;
     if(noec) {
-        corrected_final = NoCorrection(logger, dir / ("k" + itos(K)), lib, {}, paths, threads, K, W,
+        corrected_final = NoCorrection(logger, dir / ("k" + itos(K)), cached_lib, {}, paths, threads, K, W,
                                        skip, debug, load);
     } else {
         double threshold = std::stod(parser.getValue("cov-threshold"));
@@ -402,7 +422,7 @@ int main(int argc, char **argv) {
         std::pair<std::experimental::filesystem::path, std::experimental::filesystem::path> corrected1;
         if (first_stage == "alternative")
             skip = false;
-        corrected1 = AlternativeCorrection(logger, dir / ("k" + itos(k)), lib, {}, paths, threads, k, w,
+        corrected1 = AlternativeCorrection(logger, dir / ("k" + itos(k)), cached_lib, {}, paths, threads, k, w,
                                            threshold, reliable_coverage, false, false, skip, debug, load);
         if (first_stage == "alternative" || first_stage == "none")
             load = false;
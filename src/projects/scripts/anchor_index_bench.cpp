@@ -0,0 +1,94 @@
+#include "bench_fixture.hpp"
+#include "dbg/paths.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <malloc.h>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace dbg;
+
+//Builds graph of a random genome with repeats and compares anchor index of SparseDBG with std::unordered_map holding
+//the same anchors: memory footprint and lookup time for all k-mers of reads. Also reports read alignment throughput.
+int main(int argc, char **argv) {
+    CLParser parser({"genome=4000000", "repeats=200", "repeat-length=5000", "coverage=10", "read-length=10000",
+                     "k-mer-size=501", "window=2000", "threads=1", "seed=239"}, {},
+                    {"k=k-mer-size", "w=window", "t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("genome"));
+    size_t repeats = std::stoull(parser.getValue("repeats"));
+    size_t repeat_len = std::stoull(parser.getValue("repeat-length"));
+    size_t coverage = std::stoull(parser.getValue("coverage"));
+    size_t read_len = std::stoull(parser.getValue("read-length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::string genome = randomGenome(rnd, len, repeats, repeat_len);
+    std::vector<Sequence> reads = sampleReads(rnd, genome, coverage, read_len);
+    logger.info() << "Generated " << reads.size() << " reads of length " << read_len << std::endl;
+    hashing::RollingHash hasher(k, 239);
+    SparseDBG dbg = junctionGraph(logger, {Sequence(genome)}, hasher, threads);
+    auto start = std::chrono::steady_clock::now();
+    dbg.fillAnchors(w, logger, threads);
+    logger.info() << "Anchor index: " << secondsSince(start) << "s to fill, " << dbg.anchorIndexMemory() / 1024 / 1024 <<
+                  "Mb" << std::endl;
+    size_t before = mallinfo2().uordblks;
+    std::unordered_map<hashing::htype, EdgePosition, hashing::alt_hasher<hashing::htype>> map;
+    start = std::chrono::steady_clock::now();
+    for(Edge &edge : dbg.edges()) {
+        if(edge.size() <= w)
+            continue;
+        Sequence seq = edge.start()->seq + edge.seq;
+        for(hashing::KWH kmer(hasher, seq, 1); kmer.hasNext(); kmer = kmer.next()) {
+            if(kmer.pos % w == 0)
+                map.emplace(kmer.hash(), kmer.isCanonical() ? EdgePosition(edge, kmer.pos) : EdgePosition(edge, kmer.pos).RC());
+        }
+    }
+    logger.info() << "std::unordered_map: " << secondsSince(start) << "s to fill serially, " <<
+                  (mallinfo2().uordblks - before) / 1024 / 1024 << "Mb" << std::endl;
+    size_t index_hits = 0;
+    size_t map_hits = 0;
+    double index_time = 0;
+    double map_time = 0;
+    for(const Sequence &seq : reads) {
+        std::vector<hashing::htype> hashes;
+        for(hashing::KWH kmer(hasher, seq, 0);; kmer = kmer.next()) {
+            hashes.push_back(kmer.hash());
+            if(!kmer.hasNext())
+                break;
+        }
+        start = std::chrono::steady_clock::now();
+        for(hashing::htype hash : hashes)
+            index_hits += dbg.isAnchor(hash);
+        index_time += secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        for(hashing::htype hash : hashes)
+            map_hits += map.count(hash);
+        map_time += secondsSince(start);
+    }
+    logger.info() << "Lookups of read k-mers: anchor index " << index_time << "s, std::unordered_map " << map_time << "s, " <<
+                  index_hits << " and " << map_hits << " hits" << std::endl;
+//    Short pieces often contain no vertices and are aligned through anchors
+    GraphAligner aligner(dbg);
+    bool ok = index_hits == map_hits;
+    for(size_t piece_len : {read_len, k + w}) {
+        start = std::chrono::steady_clock::now();
+        size_t aligned = 0;
+        for(const Sequence &seq : reads)
+            aligned += aligner.align(seq.Subseq(0, piece_len)).len();
+        double align_time = secondsSince(start);
+        logger.info() << "GraphAligner::align of sequences of length " << piece_len << ": " << align_time << "s, " <<
+                      reads.size() / align_time << " sequences/s" << std::endl;
+        ok = ok && aligned == reads.size() * (piece_len - k);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "dbg/dbg_construction.hpp"
+#include <sequences/sequence.hpp>
+#include <common/rolling_hash.hpp>
+#include <common/logging.hpp>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+//Synthetic data shared by the graph benchmarks in this directory: a random genome with pasted repeats, reads sampled
+//from it and the graph of its junctions.
+inline double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline std::string randomGenome(std::mt19937_64 &rnd, size_t len) {
+    std::string genome(len, 'A');
+    for(char &c : genome)
+        c = "ACGT"[rnd() & 3u];
+    return std::move(genome);
+}
+
+//Each repeat is a random segment of the genome pasted over another random position
+inline std::string randomGenome(std::mt19937_64 &rnd, size_t len, size_t repeats, size_t repeat_len) {
+    std::string genome = randomGenome(rnd, len);
+    for(size_t i = 0; i < repeats; i++) {
+        std::string repeat = genome.substr(rnd() % (len - repeat_len), repeat_len);
+        genome.replace(rnd() % (len - repeat_len), repeat_len, repeat);
+    }
+    return std::move(genome);
+}
+
+//Reads of random orientation are sampled uniformly until the coverage is reached. Reads that overlap the region
+//[skip_start, skip_end) are not used, so that this region is not covered.
+inline std::vector<Sequence> sampleReads(std::mt19937_64 &rnd, const std::string &genome, size_t coverage, size_t read_len,
+                                         size_t skip_start = 0, size_t skip_end = 0) {
+    size_t len = genome.size();
+    std::vector<Sequence> reads;
+    while(reads.size() * read_len < len * coverage) {
+        size_t pos = 1 + rnd() % (len - read_len - 1);
+        bool rc = rnd() & 1u;
+        if(pos < skip_end && pos + read_len > skip_start)
+            continue;
+        Sequence seq(genome.substr(pos, read_len));
+        reads.emplace_back(rc ? !seq : seq);
+    }
+    return std::move(reads);
+}
+
+inline dbg::SparseDBG junctionGraph(logging::Logger &logger, const std::vector<Sequence> &seqs,
+                                    const hashing::RollingHash &hasher, size_t threads) {
+    std::vector<hashing::htype> junctions = findJunctions(logger, seqs, hasher, threads);
+    return constructDBG(logger, junctions, seqs, hasher, threads);
+}
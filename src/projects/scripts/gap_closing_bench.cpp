@@ -0,0 +1,72 @@
+#include "bench_fixture.hpp"
+#include "dbg/graph_modification.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace dbg;
+
+//Runs one gap closing round on a random genome with repeats: reads skip one region of the genome and a connection
+//spanning this region is inserted into the graph. Reports time of AddConnections and checks that read paths in the
+//updated graph coincide with alignments of the same reads computed from scratch.
+int main(int argc, char **argv) {
+    CLParser parser({"genome=4000000", "repeats=20", "repeat-length=5000", "gap=3000", "coverage=30", "read-length=10000",
+                     "k-mer-size=301", "window=500", "threads=1", "seed=239", "log=gap_closing_bench.log"}, {},
+                    {"k=k-mer-size", "w=window", "t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("genome"));
+    size_t repeats = std::stoull(parser.getValue("repeats"));
+    size_t repeat_len = std::stoull(parser.getValue("repeat-length"));
+    size_t gap = std::stoull(parser.getValue("gap"));
+    size_t coverage = std::stoull(parser.getValue("coverage"));
+    size_t read_len = std::stoull(parser.getValue("read-length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::string genome = randomGenome(rnd, len, repeats, repeat_len);
+    size_t gap_start = len / 2;
+    size_t gap_end = gap_start + gap;
+    std::vector<Sequence> seqs = sampleReads(rnd, genome, coverage, read_len, gap_start, gap_end);
+//    Reads next to the gap are rare, so the flanks that the connection is aligned to are covered explicitly
+    seqs.emplace_back(genome.substr(gap_start - read_len, read_len));
+    seqs.emplace_back(genome.substr(gap_end, read_len));
+    std::vector<StringContig> reads;
+    for(const Sequence &seq : seqs)
+        reads.emplace_back(seq.str(), "read" + std::to_string(reads.size()));
+    logger.info() << "Generated " << reads.size() << " reads of length " << read_len << " from genome of length " << len
+                  << " with region of length " << gap << " not covered by reads" << std::endl;
+    hashing::RollingHash hasher(k, 239);
+    SparseDBG dbg = junctionGraph(logger, seqs, hasher, threads);
+    dbg.fillAnchors(w, logger, threads);
+    ReadLogger readLogger(threads, parser.getValue("log"));
+    RecordStorage storage(dbg, 0, 10000000, threads, readLogger, true, false);
+    storage.fill(reads.begin(), reads.end(), dbg, k + w, logger, threads);
+    Sequence conn(genome.substr(gap_start - 2 * w - 2 * k, gap + 4 * w + 4 * k));
+    GraphAligner aligner(dbg);
+    GraphAlignment al1 = aligner.align(conn.Subseq(0, w + k));
+    GraphAlignment al2 = aligner.align(conn.Subseq(conn.size() - w - k));
+    std::vector<Connection> connections = {Connection(EdgePosition(al1[0].contig(), al1[0].left),
+                                                      EdgePosition(al2.back().contig(), al2.back().right), conn)};
+    auto start = std::chrono::steady_clock::now();
+    AddConnections(logger, threads, dbg, {&storage}, connections);
+    logger.info() << "AddConnections: " << secondsSince(start) << "s, " << dbg.size() << " vertices after insertion" << std::endl;
+    size_t mismatches = 0;
+    for(size_t i = 0; i < reads.size(); i++) {
+        AlignedRead &read = storage[i];
+        CompactPath expected(GraphAligner(dbg).align(seqs[i]));
+        if(!read.valid() || &read.path.start() != &expected.start() || read.path.cpath() != expected.cpath() ||
+                read.path.leftSkip() != expected.leftSkip() || read.path.rightSkip() != expected.rightSkip())
+            mismatches += 1;
+    }
+    logger.info() << mismatches << " reads with paths different from their alignment to the updated graph" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
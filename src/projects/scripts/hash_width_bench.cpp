@@ -0,0 +1,78 @@
+#include <common/chunked_hash_map.hpp>
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <parallel/algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+//Compares 64-bit and 128-bit k-mer hashes: parallel sort of hash lists, lookup in vertex index and memory footprint.
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct WideHasher {
+    size_t operator()(const uint64_t &x) const {
+        return (size_t(x) * 31) ^ size_t(x >> 32u);
+    }
+
+    size_t operator()(const unsigned __int128 &x) const {
+        return (size_t(x) * 31) ^ size_t(x >> 64u);
+    }
+};
+
+template<class Key>
+void benchmark(logging::Logger &logger, const std::vector<uint64_t> &low, const std::vector<uint64_t> &high, size_t threads) {
+    std::string name = itos(sizeof(Key) * 8) + "-bit";
+    std::vector<Key> hashes(low.size());
+    for(size_t i = 0; i < low.size(); i++) {
+        hashes[i] = (Key(high[i]) << 32u << 32u) | low[i];
+    }
+    omp_set_num_threads(threads);
+    auto start = std::chrono::steady_clock::now();
+    __gnu_parallel::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    logger.info() << name << " sort of " << low.size() << " hashes (" << threads << " threads): " << secondsSince(start) <<
+                  "s, " << low.size() * sizeof(Key) / 1024 / 1024 << "Mb hash list" << std::endl;
+    ChunkedHashMap<Key, size_t, WideHasher> index;
+    index.reserve(hashes.size());
+    start = std::chrono::steady_clock::now();
+#pragma omp parallel for default(none) shared(index, hashes) schedule(static, 1 << 16)
+    for(size_t i = 0; i < hashes.size(); i++) {
+        index.emplaceConcurrent(hashes[i], i);
+    }
+    logger.info() << name << " index construction: " << secondsSince(start) << "s, " <<
+                  index.memoryUsage() / 1024 / 1024 << "Mb index memory" << std::endl;
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+#pragma omp parallel for default(none) shared(index, hashes) reduction(+:found) schedule(static, 1 << 16)
+    for(size_t i = 0; i < hashes.size(); i++) {
+        found += index.count(hashes[i]) + index.count(hashes[i] + 1);
+    }
+    logger.info() << name << " lookup of " << hashes.size() * 2 << " hashes: " << secondsSince(start) << "s, " <<
+                  found << " found" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"hashes=10000000", "threads=8", "seed=239"}, {}, {"t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t n = std::stoull(parser.getValue("hashes"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::vector<uint64_t> low(n);
+    std::vector<uint64_t> high(n);
+    for(size_t i = 0; i < n; i++) {
+        low[i] = rnd() & ~1ull;
+        high[i] = rnd();
+    }
+    logger.info() << "Generated " << n << " random hashes" << std::endl;
+    benchmark<uint64_t>(logger, low, high, threads);
+    benchmark<unsigned __int128>(logger, low, high, threads);
+    return 0;
+}
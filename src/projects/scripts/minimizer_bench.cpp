@@ -0,0 +1,58 @@
+#include <common/rolling_hash.hpp>
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace hashing;
+
+//Compares MinimizerCalculator with MinimizerKernel on random reads: running time and equality of produced hashes.
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"reads=2000", "length=20000", "k-mer-size=501", "window=2000", "seed=239"}, {}, {"k=k-mer-size", "w=window"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t n = std::stoull(parser.getValue("reads"));
+    size_t len = std::stoull(parser.getValue("length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::vector<Sequence> reads;
+    for(size_t i = 0; i < n; i++) {
+        std::string s(len, 'A');
+        for(char &c : s)
+            c = "ACGT"[rnd() & 3u];
+        reads.emplace_back(s);
+    }
+    logger.info() << "Generated " << n << " random reads of length " << len << std::endl;
+    RollingHash hasher(k, 239);
+    std::vector<std::vector<htype>> expected;
+    auto start = std::chrono::steady_clock::now();
+    for(const Sequence &seq : reads) {
+        MinimizerCalculator calc(seq, hasher, w);
+        expected.emplace_back(calc.minimizerHashs());
+    }
+    logger.info() << "MinimizerCalculator: " << secondsSince(start) << "s" << std::endl;
+    MinimizerKernel kernel(hasher, w);
+    std::vector<htype> res;
+    size_t mismatches = 0;
+    double kernel_time = 0;
+    for(size_t i = 0; i < reads.size(); i++) {
+        start = std::chrono::steady_clock::now();
+        kernel.minimizerHashs(reads[i], res);
+        kernel_time += secondsSince(start);
+        if(res != expected[i])
+            mismatches += 1;
+    }
+    logger.info() << "MinimizerKernel: " << kernel_time << "s, " << mismatches << " reads with different minimizers" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
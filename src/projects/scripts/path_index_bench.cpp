@@ -0,0 +1,94 @@
+#include "bench_fixture.hpp"
+#include "dbg/graph_alignment_storage.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <malloc.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace dbg;
+
+//Stores read paths of a random genome with many copies of one repeat, so that repeat vertices have many different path
+//extensions. Reports memory of stored extensions, time of prefix queries that are used by read correction and time of
+//removing and adding back read paths. Query results are summed into a checksum.
+int main(int argc, char **argv) {
+    CLParser parser({"genome=2000000", "copies=300", "repeat-length=3000", "coverage=30", "read-length=10000",
+                     "k-mer-size=501", "window=1000", "max-length=10000", "threads=1", "fill-threads=none", "seed=239",
+                     "log=path_index_bench.log"}, {}, {"k=k-mer-size", "w=window", "t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("genome"));
+    size_t copies = std::stoull(parser.getValue("copies"));
+    size_t repeat_len = std::stoull(parser.getValue("repeat-length"));
+    size_t coverage = std::stoull(parser.getValue("coverage"));
+    size_t read_len = std::stoull(parser.getValue("read-length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    size_t max_len = std::stoull(parser.getValue("max-length"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::string genome = randomGenome(rnd, len);
+    std::string repeat = genome.substr(0, repeat_len);
+    for(size_t i = 0; i < copies; i++)
+        genome.replace(rnd() % (len - repeat_len), repeat_len, repeat);
+    std::vector<StringContig> reads;
+    for(const Sequence &seq : sampleReads(rnd, genome, coverage, read_len))
+        reads.emplace_back(seq.str(), "read" + std::to_string(reads.size()));
+    logger.info() << "Generated " << reads.size() << " reads of length " << read_len << std::endl;
+    hashing::RollingHash hasher(k, 239);
+    SparseDBG dbg = junctionGraph(logger, {Sequence(genome)}, hasher, threads);
+    dbg.fillAnchors(w, logger, threads);
+//    Thread scaling of RecordStorage::fill, e.g. --fill-threads 1,2,4,8,16
+    if(parser.getValue("fill-threads") != "none") {
+        for(const std::string &val : split(parser.getValue("fill-threads"), ",")) {
+            size_t fill_threads = std::stoull(val);
+            ReadLogger scalingLogger(fill_threads, parser.getValue("log"));
+            RecordStorage scaling(dbg, 0, max_len, fill_threads, scalingLogger, false, false, true);
+            auto scaling_start = std::chrono::steady_clock::now();
+            scaling.fill(reads.begin(), reads.end(), dbg, k + w, logger, fill_threads);
+            logger.info() << "RecordStorage::fill with " << fill_threads << " threads: " << secondsSince(scaling_start) << "s" << std::endl;
+        }
+    }
+    ReadLogger readLogger(threads, parser.getValue("log"));
+    RecordStorage storage(dbg, 0, max_len, threads, readLogger, false, false, true);
+    size_t before = mallinfo2().uordblks;
+    auto start = std::chrono::steady_clock::now();
+    storage.fill(reads.begin(), reads.end(), dbg, k + w, logger, threads);
+    double fill_time = secondsSince(start);
+    size_t max_cov = 0;
+    for(Vertex &vertex : dbg.vertices())
+        max_cov = std::max(max_cov, storage.getRecord(vertex).coverage());
+    logger.info() << "RecordStorage::fill: " << fill_time << "s, " << (mallinfo2().uordblks - before) / 1024 / 1024 <<
+                  "Mb for read paths and extensions, " << max_cov << " extensions at the most covered vertex" << std::endl;
+    size_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for(AlignedRead &read : storage) {
+        const CompactPath &path = read.path;
+        if(!path.valid())
+            continue;
+        const VertexRecord &rec = storage.getRecord(path.start());
+        for(size_t i = 1; i <= path.size(); i++)
+            checksum += rec.countStartsWith(path.cpath().Subseq(0, i));
+        checksum += rec.getUniqueExtension(path.cpath().Subseq(0, 1), 1, 0);
+        checksum += rec.getFullUniqueExtension(path.cpath().Subseq(0, 1), 1, 0).size();
+        checksum += rec.getBulgeAlternatives(path.getAlignment().finish(), 4).size();
+    }
+    logger.info() << "Prefix queries: " << secondsSince(start) << "s, checksum " << checksum << std::endl;
+    start = std::chrono::steady_clock::now();
+    for(AlignedRead &read : storage) {
+        storage.removeSubpath(read.path);
+        storage.removeSubpath(read.path.RC());
+    }
+    for(AlignedRead &read : storage) {
+        storage.addSubpath(read.path);
+        storage.addSubpath(read.path.RC());
+    }
+    logger.info() << "Removing and adding back all read paths: " << secondsSince(start) << "s" << std::endl;
+    return 0;
+}
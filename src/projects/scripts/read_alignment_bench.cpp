@@ -0,0 +1,138 @@
+#include "bench_fixture.hpp"
+#include "dbg/frozen_dbg.hpp"
+#include "dbg/compact_path.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace dbg;
+
+//Aligns random reads to the graph of a random genome with repeats. Reports time of extractVertexPositions, checks its
+//result against k-mer by k-mer lookup and reports read alignment throughput per thread. Then compares collection of
+//compact read paths and their reverse complements as in RecordStorage::fill through GraphAlignment with collection
+//through per-thread alignment buffers. Number of allocations is counted by replaced operator new.
+std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *res = std::malloc(size == 0 ? 1 : size);
+    if(res == nullptr)
+        throw std::bad_alloc();
+    return res;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+bool sameCompactPath(const CompactPath &a, const CompactPath &b) {
+    return &a.start() == &b.start() && a.cpath() == b.cpath() && a.leftSkip() == b.leftSkip() &&
+            a.rightSkip() == b.rightSkip();
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"genome=20000000", "repeats=200", "repeat-length=5000", "coverage=5", "read-length=10000",
+                     "k-mer-size=501", "window=2000", "threads=1", "seed=239"}, {},
+                    {"k=k-mer-size", "w=window", "t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("genome"));
+    size_t repeats = std::stoull(parser.getValue("repeats"));
+    size_t repeat_len = std::stoull(parser.getValue("repeat-length"));
+    size_t coverage = std::stoull(parser.getValue("coverage"));
+    size_t read_len = std::stoull(parser.getValue("read-length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::string genome = randomGenome(rnd, len, repeats, repeat_len);
+    std::vector<Sequence> reads = sampleReads(rnd, genome, coverage, read_len);
+    logger.info() << "Generated " << reads.size() << " reads of length " << read_len << std::endl;
+    hashing::RollingHash hasher(k, 239);
+    SparseDBG dbg = junctionGraph(logger, {Sequence(genome)}, hasher, threads);
+//    Most reads contain no junctions and are aligned through anchors
+    dbg.fillAnchors(w, logger, threads);
+    logger.info() << "Graph has " << dbg.size() << " vertex pairs" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for(const Sequence &seq : reads)
+        found += dbg.extractVertexPositions(seq).size();
+    double extract_time = secondsSince(start);
+    logger.info() << "extractVertexPositions: " << extract_time << "s, " << reads.size() / extract_time << " reads/s, " <<
+                  found << " vertex positions" << std::endl;
+    start = std::chrono::steady_clock::now();
+    size_t mismatches = 0;
+    for(const Sequence &seq : reads) {
+        std::vector<hashing::KWH> batched = dbg.extractVertexPositions(seq);
+        size_t i = 0;
+        for(hashing::KWH kwh(hasher, seq, 0);; kwh = kwh.next()) {
+            if(dbg.containsVertex(kwh.hash())) {
+                if(i >= batched.size() || batched[i].pos != kwh.pos || batched[i].fHash() != kwh.fHash() ||
+                        batched[i].rHash() != kwh.rHash())
+                    mismatches++;
+                i++;
+            }
+            if(!kwh.hasNext())
+                break;
+        }
+        if(i != batched.size())
+            mismatches++;
+    }
+    logger.info() << "K-mer by k-mer lookup: " << secondsSince(start) << "s including batched extraction, " <<
+                  mismatches << " reads with different vertex positions" << std::endl;
+    FrozenDBG frozen(dbg, threads);
+    start = std::chrono::steady_clock::now();
+    size_t aligned = 0;
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(reads, dbg, frozen) reduction(+:aligned) schedule(dynamic, 16)
+    for(size_t i = 0; i < reads.size(); i++) {
+        aligned += GraphAligner(dbg, frozen).align(reads[i]).len();
+    }
+    double align_time = secondsSince(start);
+    logger.info() << "GraphAligner::align (" << threads << " threads): " << align_time << "s, " <<
+                  reads.size() / align_time / threads << " reads/s per thread" << std::endl;
+    std::vector<CompactPath> paths(reads.size() * 2);
+    size_t allocations_before = allocations;
+    start = std::chrono::steady_clock::now();
+#pragma omp parallel for default(none) shared(reads, dbg, frozen, paths) schedule(dynamic, 16)
+    for(size_t i = 0; i < reads.size(); i++) {
+        GraphAlignment path = GraphAligner(dbg, frozen).align(reads[i]);
+        paths[i * 2] = CompactPath(path);
+        paths[i * 2 + 1] = CompactPath(path.RC());
+    }
+    align_time = secondsSince(start);
+    logger.info() << "Compact paths through GraphAlignment: " << align_time << "s, " << reads.size() / align_time / threads <<
+                  " reads/s per thread, " << double(allocations - allocations_before) / reads.size() <<
+                  " allocations per read" << std::endl;
+    std::vector<AlignmentBuffer> buffers(threads);
+    SequenceArena arena;
+    size_t different = 0;
+    allocations_before = allocations;
+    start = std::chrono::steady_clock::now();
+#pragma omp parallel for default(none) shared(reads, dbg, frozen, paths, buffers, arena) reduction(+:different) schedule(dynamic, 16)
+    for(size_t i = 0; i < reads.size(); i++) {
+        AlignmentBuffer &buffer = buffers[omp_get_thread_num()];
+        GraphAligner(dbg, frozen).align(reads[i], buffer);
+        different += !sameCompactPath(CompactPath::FromBuffer(buffer, arena), paths[i * 2]);
+        different += !sameCompactPath(CompactPath::RCFromBuffer(buffer, arena), paths[i * 2 + 1]);
+    }
+    align_time = secondsSince(start);
+    logger.info() << "Compact paths through alignment buffers: " << align_time << "s, " << reads.size() / align_time / threads <<
+                  " reads/s per thread, " << double(allocations - allocations_before) / reads.size() <<
+                  " allocations per read, " << different << " paths different" << std::endl;
+    return mismatches == 0 && different == 0 && aligned == reads.size() * (read_len - k) ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <sequences/sequence.hpp>
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+//Compares speed of word-parallel prefix comparison and packing of Sequence with nucleotide by nucleotide
+//implementations on random sequences with arbitrary offsets and orientations. Correctness of these primitives is
+//checked by SequenceOpsTest.
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t scalarCommonPrefix(const Sequence &a, const Sequence &b) {
+    size_t res = 0;
+    while(res < a.size() && res < b.size() && a[res] == b[res])
+        res += 1;
+    return res;
+}
+
+std::vector<u_int64_t> scalarPacked(const Sequence &a) {
+    std::vector<u_int64_t> res(Sequence::PackedSize(a.size()));
+    for(size_t i = 0; i < a.size(); i++)
+        res[i >> 5u] |= u_int64_t(a[i]) << ((i & 31u) << 1u);
+    return res;
+}
+
+std::string randomString(std::mt19937_64 &rnd, size_t len) {
+    std::string res(len, 'A');
+    for(char &c : res)
+        c = "ACGT"[rnd() & 3u];
+    return res;
+}
+
+//Sequence equal to s stored with random padding in a random orientation
+Sequence randomView(std::mt19937_64 &rnd, const std::string &s) {
+    size_t left = rnd() % 70;
+    std::string padded = randomString(rnd, left) + s + randomString(rnd, rnd() % 70);
+    if(rnd() & 1u)
+        return Sequence(padded).Subseq(left, left + s.size());
+    return (!Sequence(padded, true)).Subseq(left, left + s.size());
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"length=10000", "pairs=1000", "rounds=100", "seed=239"}, {}, {});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("length"));
+    size_t pairs = std::stoull(parser.getValue("pairs"));
+    size_t rounds = std::stoull(parser.getValue("rounds"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::vector<std::pair<Sequence, Sequence>> seqs;
+    for(size_t i = 0; i < pairs; i++) {
+        std::string s = randomString(rnd, len);
+        seqs.emplace_back(randomView(rnd, s), randomView(rnd, s));
+    }
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t round = 0; round < rounds; round++)
+        for(auto &p : seqs)
+            checksum += scalarCommonPrefix(p.first, p.second);
+    double scalar_time = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for(size_t round = 0; round < rounds; round++)
+        for(auto &p : seqs)
+            checksum -= p.first.commonPrefix(p.second);
+    double word_time = secondsSince(start);
+    logger.info() << "commonPrefix of equal sequences of length " << len << ": scalar " << scalar_time << "s, word-parallel "
+                  << word_time << "s" << std::endl;
+    start = std::chrono::steady_clock::now();
+    for(size_t round = 0; round < rounds; round++)
+        for(auto &p : seqs)
+            checksum += scalarPacked(!p.first)[0];
+    scalar_time = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    std::vector<u_int64_t> packed;
+    for(size_t round = 0; round < rounds; round++)
+        for(auto &p : seqs) {
+            packed.clear();
+            (!p.first).writePacked(packed);
+            checksum -= packed[0];
+        }
+    word_time = secondsSince(start);
+    logger.info() << "Packing reverse complement sequences of length " << len << ": scalar " << scalar_time <<
+                  "s, word-parallel " << word_time << "s" << std::endl;
+//    Checksum keeps both loops from being optimized away
+    return checksum == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include "bench_fixture.hpp"
+#include "dbg/graph_algorithms.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace dbg;
+
+//Builds graph of a random genome with repeats from junctions and minimizers, so that unitigs consist of many edges,
+//and reports time of merging unbranching paths. The merged graph is compared with the graph built from junctions only.
+size_t totalLength(SparseDBG &dbg) {
+    size_t res = 0;
+    for(Edge &edge : dbg.edges())
+        res += edge.size();
+    return res;
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"genome=20000000", "repeats=200", "repeat-length=20000", "k-mer-size=5001", "window=500",
+                     "threads=1", "seed=239"}, {}, {"k=k-mer-size", "w=window", "t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t len = std::stoull(parser.getValue("genome"));
+    size_t repeats = std::stoull(parser.getValue("repeats"));
+    size_t repeat_len = std::stoull(parser.getValue("repeat-length"));
+    size_t k = std::stoull(parser.getValue("k-mer-size"));
+    size_t w = std::stoull(parser.getValue("window"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::string genome = randomGenome(rnd, len, repeats, repeat_len);
+    hashing::RollingHash hasher(k, 239);
+    std::vector<Sequence> genome_seqs = {Sequence(genome)};
+    std::vector<hashing::htype> junctions = findJunctions(logger, genome_seqs, hasher, threads);
+    std::vector<hashing::htype> vertices = hashing::MinimizerCalculator(genome_seqs[0], hasher, w).minimizerHashs();
+    vertices.insert(vertices.end(), junctions.begin(), junctions.end());
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    SparseDBG dbg(vertices, hasher, threads);
+    for(const Sequence &seq : genome_seqs)
+        dbg.processRead(seq);
+    dbg.publishStagedEdges(logger, threads);
+    std::vector<std::pair<Vertex *, Edge *>> tips;
+    for(Vertex &vertex : dbg.verticesUnique()) {
+        for(Vertex *v : {&vertex, &vertex.rc()})
+            for(Edge &edge : *v)
+                if(edge.end() == nullptr)
+                    tips.emplace_back(v, &edge);
+    }
+    for(std::pair<Vertex *, Edge *> tip : tips)
+        dbg.bindTip(*tip.first, *tip.second);
+    size_t before = dbg.size();
+    auto start = std::chrono::steady_clock::now();
+    mergeAll(logger, dbg, threads);
+    double merge_time = secondsSince(start);
+    logger.info() << "Merged unbranching paths of graph with " << before << " vertex pairs in " << merge_time << "s, " <<
+                  dbg.size() << " vertex pairs left" << std::endl;
+    SparseDBG expected = constructDBG(logger, junctions, genome_seqs, hasher, threads);
+    bool ok = dbg.size() == expected.size() && totalLength(dbg) == totalLength(expected);
+    logger.info() << "Merged graph " << (ok ? "coincides" : "differs") << " with graph built from junctions" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include "dbg/sparse_dbg.hpp"
+#include <common/cl_parser.hpp>
+#include <common/logging.hpp>
+#include <common/chunked_hash_map.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace dbg;
+
+//Compares vertex storage indices used by SparseDBG on random hashes: insertion and lookup time and memory footprint.
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(logging::Logger &logger, HashIndexType type, const std::vector<hashing::htype> &hashes, size_t threads) {
+    std::string name = hashIndexTypeName(type);
+    {
+        SparseDBG::vertex_map_type v(type);
+        auto start = std::chrono::steady_clock::now();
+        for(hashing::htype h : hashes)
+            v.emplace(h, h);
+        logger.info() << name << " serial insert: " << secondsSince(start) << "s, " << v.size() << " vertices, " <<
+                      v.memoryUsage() / 1024 / 1024 << "Mb index memory" << std::endl;
+    }
+    SparseDBG::vertex_map_type v(type);
+    auto start = std::chrono::steady_clock::now();
+    v.reserve(hashes.size());
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(v, hashes) schedule(static, 1 << 16)
+    for(size_t i = 0; i < hashes.size(); i++) {
+        v.emplaceConcurrent(hashes[i], hashes[i]);
+    }
+    logger.info() << name << " concurrent insert (" << threads << " threads): " << secondsSince(start) << "s, " <<
+                  v.memoryUsage() / 1024 / 1024 << "Mb index memory" << std::endl;
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+#pragma omp parallel for default(none) shared(v, hashes) reduction(+:found) schedule(static, 1 << 16)
+    for(size_t i = 0; i < hashes.size(); i++) {
+        found += v.count(hashes[i]) + v.count(hashes[i] + 1);
+    }
+    logger.info() << name << " lookup of " << hashes.size() * 2 << " hashes: " << secondsSince(start) << "s, " <<
+                  found << " found" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"hashes=10000000", "threads=8", "seed=239"}, {}, {"t=threads"});
+    parser.parseCL(argc, argv);
+    if (!parser.check().empty()) {
+        std::cout << "Incorrect parameters" << std::endl;
+        std::cout << parser.check() << std::endl;
+        return 1;
+    }
+    logging::Logger logger;
+    size_t n = std::stoull(parser.getValue("hashes"));
+    size_t threads = std::stoull(parser.getValue("threads"));
+    std::mt19937_64 rnd(std::stoull(parser.getValue("seed")));
+    std::vector<hashing::htype> hashes(n);
+    for(hashing::htype &h : hashes) {
+        h = (hashing::htype(rnd()) << 32u << 32u) | (rnd() & ~1ull);
+    }
+    logger.info() << "Generated " << n << " random hashes" << std::endl;
+    benchmark(logger, HashIndexType::chained, hashes, threads);
+    benchmark(logger, HashIndexType::open_addressing, hashes, threads);
+    return 0;
+}
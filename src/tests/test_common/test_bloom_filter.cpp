@@ -0,0 +1,33 @@
+#include "gtest/gtest.h"
+#include <cmath>
+//bloom_filter.hpp relies on its includers for these
+#include "common/omp_utils.hpp"
+#include "common/bloom_filter.hpp"
+#include <memory>
+#include <random>
+
+TEST(BlockedBloomFilterTest, ContainsAllMatchesContains) {
+    bloom_parameters parameters;
+    parameters.projected_element_count = 10000;
+    parameters.false_positive_probability = 0.01;
+    parameters.compute_optimal_parameters();
+    BlockedBloomFilter filter(parameters);
+    std::mt19937_64 rnd(239);
+    std::vector<uint64_t> keys(20000);
+    for(uint64_t &key : keys)
+        key = rnd();
+    for(size_t i = 0; i < keys.size(); i += 2)
+        filter.insert(keys[i]);
+//    Batch sizes that are not multiples of the prefetch group
+    for(size_t n : {1, 7, 16, 17, 100}) {
+        size_t batched = keys.size() / n * n;
+        std::unique_ptr<bool[]> res(new bool[batched]);
+        for(size_t start = 0; start < batched; start += n)
+            filter.containsAll(keys.data() + start, n, res.get() + start);
+        for(size_t i = 0; i < batched; i++) {
+            ASSERT_EQ(res[i], filter.contains(keys[i])) << n << " " << i;
+            if(i % 2 == 0)
+                ASSERT_TRUE(res[i]);
+        }
+    }
+}
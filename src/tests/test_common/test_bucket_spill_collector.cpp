@@ -0,0 +1,28 @@
+#include "gtest/gtest.h"
+#include "common/bucket_spill_collector.hpp"
+#include <random>
+#include <unistd.h>
+
+TEST(BucketSpillCollectorTest, SpilledValuesAreUnique) {
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() /
+            ("spill_collector_test_" + std::to_string(getpid()));
+    std::mt19937_64 rnd(239);
+    std::vector<uint64_t> expected;
+    {
+        BucketSpillCollector<uint64_t> collector(dir, 1, 1 << 12);
+//        Small values imitate minimal hashes that share their highest bits
+        for(size_t i = 0; i < 20000; i++) {
+            std::vector<uint64_t> vals = {rnd() >> 20u, rnd() % 1000};
+            expected.insert(expected.end(), vals.begin(), vals.end());
+            collector.addAll(vals.begin(), vals.end());
+        }
+        ASSERT_GT(collector.spilledBytes(), 0);
+        std::vector<uint64_t> res = collector.collectUnique(1);
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        std::sort(res.begin(), res.end());
+        ASSERT_EQ(res, expected);
+    }
+    ASSERT_TRUE(std::experimental::filesystem::is_empty(dir));
+    std::experimental::filesystem::remove_all(dir);
+}
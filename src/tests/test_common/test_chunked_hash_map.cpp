@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "common/chunked_hash_map.hpp"
+#include <algorithm>
+#include <random>
+
+namespace {
+    typedef ChunkedHashMap<uint64_t, uint64_t> map_type;
+
+    std::vector<uint64_t> shuffledKeys(size_t n) {
+        std::vector<uint64_t> keys(n);
+        for(size_t i = 0; i < n; i++)
+            keys[i] = i * 7919 + 13;
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64(239));
+        return keys;
+    }
+}
+
+TEST(ChunkedHashMapTest, BulkEmplaceUnsortedKeys) {
+    for(HashIndexType index_type : {HashIndexType::open_addressing, HashIndexType::chained}) {
+        std::vector<uint64_t> keys = shuffledKeys(50000);
+        map_type map(index_type);
+        map.bulkEmplace(keys, 4);
+        ASSERT_EQ(map.size(), keys.size());
+//        Values are stored in the order of keys
+        size_t i = 0;
+        for(auto &it : map) {
+            ASSERT_EQ(it.first, keys[i]);
+            ASSERT_EQ(it.second, keys[i]);
+            i++;
+        }
+        for(uint64_t key : keys)
+            ASSERT_TRUE(map.find(key) != map.end());
+        ASSERT_TRUE(map.find(1) == map.end());
+    }
+}
+
+TEST(ChunkedHashMapDeathTest, BulkEmplaceDuplicateKey) {
+    std::vector<uint64_t> keys = shuffledKeys(1000);
+    keys.push_back(keys[500]);
+    for(HashIndexType index_type : {HashIndexType::open_addressing, HashIndexType::chained}) {
+        ASSERT_DEATH({
+            map_type map(index_type);
+            map.bulkEmplace(keys, 1);
+        }, "");
+    }
+}
@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "dbg/dbg_construction.hpp"
+#include "dbg/frozen_dbg.hpp"
+#include <random>
+
+namespace {
+    dbg::SparseDBG randomGraph(const hashing::RollingHash &hasher) {
+        std::mt19937_64 rnd(239);
+        std::string genome(20000, 'A');
+        for(char &c : genome)
+            c = "ACGT"[rnd() & 3u];
+        for(size_t i = 0; i < 10; i++)
+            genome.replace(rnd() % 19000, 500, genome.substr(rnd() % 19000, 500));
+        logging::Logger logger;
+        std::vector<Sequence> seqs = {Sequence(genome)};
+        return constructDBG(logger, findJunctions(logger, seqs, hasher, 1), seqs, hasher, 1);
+    }
+
+    void checkIndex(dbg::SparseDBG &dbg, const dbg::FrozenDBG &frozen) {
+        ASSERT_EQ(frozen.vertexCount(), dbg.size() * 2);
+        for(dbg::Vertex &vertex : dbg.vertices()) {
+            dbg::FrozenDBG::id_type v = frozen.id(vertex);
+            ASSERT_EQ(&frozen.vertex(v), &vertex);
+            ASSERT_EQ(&frozen.vertex(frozen.rc(v)), &vertex.rc());
+            for(dbg::Edge &edge : vertex) {
+                dbg::FrozenDBG::id_type e = frozen.id(edge);
+                ASSERT_EQ(&frozen.edge(e), &edge);
+                ASSERT_EQ(frozen.outgoing(v, edge.seq[0]), e);
+                ASSERT_EQ(&frozen.vertex(frozen.end(e)), edge.end());
+                ASSERT_EQ(frozen.edgeSize(e), edge.size());
+            }
+        }
+    }
+}
+
+//Ids are kept in FrozenDBG, so building a second index does not invalidate the first one
+TEST(FrozenDBGTest, SeveralIndicesOfOneGraph) {
+    hashing::RollingHash hasher(31, 239);
+    dbg::SparseDBG dbg = randomGraph(hasher);
+    ASSERT_GT(dbg.size(), 1);
+    dbg::FrozenDBG first(dbg, 1);
+    dbg::FrozenDBG second(dbg, 1);
+    ASSERT_NO_FATAL_FAILURE(checkIndex(dbg, first));
+    ASSERT_NO_FATAL_FAILURE(checkIndex(dbg, second));
+}
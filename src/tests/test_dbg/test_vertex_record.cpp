@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "dbg/graph_alignment_storage.hpp"
+#include <map>
+#include <random>
+
+//Radix tree of path extensions in VertexRecord is compared with a plain list of stored paths.
+class VertexRecordTest : public ::testing::Test {
+protected:
+    dbg::SparseDBG dbg;
+    VertexRecord rec;
+    std::map<std::string, size_t> reference;
+
+    VertexRecordTest() : dbg(hashing::RollingHash(5, 239)), rec(dbg.addVertex(Sequence("ACGTA"))) {}
+
+    size_t nodeCount() const {return rec.nodes.size();}
+    size_t deadCount() const {return rec.dead_cnt;}
+    void compress() {rec.compress();}
+
+    void add(const std::string &s) {
+        rec.addPath(Sequence(s));
+        reference[s] += 1;
+    }
+
+    void remove(const std::string &s) {
+        rec.removePath(Sequence(s));
+        if(--reference[s] == 0)
+            reference.erase(s);
+    }
+
+    size_t expectedStartsWith(const std::string &prefix) const {
+        size_t res = 0;
+        for(const auto &it : reference)
+            if(it.first.compare(0, prefix.size(), prefix) == 0)
+                res += it.second;
+        return res;
+    }
+
+    void check(const std::vector<std::string> &prefixes) const {
+        std::map<std::string, size_t> stored;
+        for(const std::pair<Sequence, size_t> &path : rec.paths())
+            stored[path.first.str()] += path.second;
+        ASSERT_EQ(stored, reference);
+        ASSERT_EQ(rec.coverage(), expectedStartsWith(""));
+        for(const std::string &prefix : prefixes)
+            ASSERT_EQ(rec.countStartsWith(Sequence(prefix)), expectedStartsWith(prefix)) << prefix;
+    }
+};
+
+TEST_F(VertexRecordTest, SplitsLabels) {
+    add("ACGTACGT");
+    ASSERT_EQ(nodeCount(), 2);
+    add("ACGTTT");
+    ASSERT_EQ(nodeCount(), 4);
+//    Path that ends in the middle of a label splits it without a new branch
+    add("AC");
+    ASSERT_EQ(nodeCount(), 5);
+    add("ACGTACGT");
+    add("G");
+    check({"", "A", "AC", "ACG", "ACGT", "ACGTA", "ACGTT", "ACGTACGT", "ACGTACGTA", "G", "T"});
+}
+
+TEST_F(VertexRecordTest, ReusesDeadNodes) {
+    add("ACGTACGT");
+    add("ACGTTT");
+    add("CCCC");
+    size_t nodes = nodeCount();
+    remove("ACGTTT");
+    ASSERT_EQ(deadCount(), 1);
+    check({"ACGT", "ACGTT"});
+    add("ACGTTT");
+    ASSERT_EQ(deadCount(), 0);
+    ASSERT_EQ(nodeCount(), nodes);
+//    Path through dead node that leaves its label in the middle splits the dead node
+    remove("ACGTTT");
+    add("ACGTTA");
+    ASSERT_EQ(deadCount(), 1);
+    check({"ACGTT", "ACGTTA", "ACGTTT"});
+}
+
+TEST_F(VertexRecordTest, CompressKeepsPaths) {
+    add("ACGTACGT");
+    add("ACGTTT");
+    add("ACGTTA");
+    add("CCCC");
+    remove("ACGTTT");
+    remove("CCCC");
+    ASSERT_GT(deadCount(), 0);
+    compress();
+    ASSERT_EQ(deadCount(), 0);
+    ASSERT_EQ(nodeCount(), 4);
+    check({"ACGT", "ACGTT", "ACGTTA", "C"});
+}
+
+TEST_F(VertexRecordTest, MatchesReferenceList) {
+    std::mt19937_64 rnd(239);
+    std::vector<std::string> pool;
+    std::vector<std::string> prefixes = {""};
+    for(size_t i = 0; i < 60; i++) {
+//        Paths share prefixes with earlier paths so that labels are split at different depths
+        std::string s = pool.empty() || rnd() % 4 == 0 ? "" : pool[rnd() % pool.size()];
+        s = s.substr(0, rnd() % (s.size() + 1));
+        for(size_t len = rnd() % 12; len > 0; len--)
+            s += "ACGT"[rnd() & 3u];
+        pool.push_back(s);
+        prefixes.push_back(s.substr(0, rnd() % (s.size() + 1)));
+    }
+    std::vector<std::string> stored;
+    for(size_t step = 0; step < 3000; step++) {
+        if(stored.empty() || rnd() % 5 < 3) {
+            stored.push_back(pool[rnd() % pool.size()]);
+            add(stored.back());
+        } else {
+            size_t i = rnd() % stored.size();
+            std::swap(stored[i], stored.back());
+            remove(stored.back());
+            stored.pop_back();
+        }
+        if(step % 50 == 0)
+            ASSERT_NO_FATAL_FAILURE(check(prefixes));
+    }
+    ASSERT_NO_FATAL_FAILURE(check(prefixes));
+    compress();
+    ASSERT_NO_FATAL_FAILURE(check(prefixes));
+}
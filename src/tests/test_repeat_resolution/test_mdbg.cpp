@@ -13,7 +13,7 @@ using RawEdgeInfo =
 std::vector<std::tuple<RRVertexType, RRVertexType, std::string>>;
 
 std::vector<SuccinctEdgeInfo>
-GetEdgeInfo(std::map<RRVertexType, dbg::Vertex> &vertexes,
+GetEdgeInfo(std::map<RRVertexType, dbg::VertexPair> &vertexes,
             std::vector<dbg::Edge> &edges, const RawEdgeInfo &raw_edge_info,
             int k, bool unique) {
     for (const auto &[st, en, str] : raw_edge_info) {
@@ -95,7 +95,7 @@ TEST(DB1, Basic) {
 
     const bool frozen = false;
     const bool unique = false;
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     RawEdgeInfo raw_edge_info{{0, 2, "CCT"},  // 0
                               {1, 2, "GACT"}, // 1
@@ -133,7 +133,7 @@ TEST(DBSingleEdge1, Basic) {
 
     const bool frozen = false;
     const bool unique = false;
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<std::tuple<RRVertexType, RRVertexType, std::string>>
         raw_edge_info{{0, 1, "ACGTTGCA"}}; // 0
@@ -171,7 +171,7 @@ TEST(DBSingleEdge2, Basic) {
 
     const bool frozen = false;
     const bool unique = false;
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<std::tuple<RRVertexType, RRVertexType, std::string>>
         raw_edge_info{{0, 1, "ACGCA"}}; // 0
@@ -210,7 +210,7 @@ TEST(DBSingleEdge3, Basic) {
     const bool unique = false;
     std::vector<std::tuple<RRVertexType, RRVertexType, std::string>>
         raw_edge_info{{0, 1, "ACGTGCA"}}; // 0
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, unique);
@@ -245,7 +245,7 @@ TEST(DBStVertex, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "AAAAA"}, {0, 2, "AAACA"}, {0, 3, "AAA"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -283,7 +283,7 @@ TEST(DBEvVertex, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 3, "AAAAA"}, {1, 3, "AACAA"}, {2, 3, "AAA"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -322,7 +322,7 @@ TEST(DB1inVertex, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "AACAG"}, {1, 2, "AGACC"}, {1, 3, "AGATT"}, {1, 4, "AGAGG"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -361,7 +361,7 @@ TEST(DB1inVertex, WithShortEdge) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "CAG"}, {1, 2, "AGACC"}, {1, 3, "AGATT"}, {1, 4, "AGAGG"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -398,7 +398,7 @@ TEST(DB1outVertex, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 3, "CCAGA"}, {1, 3, "TTAGA"}, {2, 3, "GGAGA"}, {3, 4, "GAAAA"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -437,7 +437,7 @@ TEST(DB1outVertex, WithShortEdge) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 3, "CCAGA"}, {1, 3, "TTAGA"}, {2, 3, "GGAGA"}, {3, 4, "GAA"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -474,7 +474,7 @@ TEST(DBComplexVertex, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {1, 2, "GGAAA"}, {2, 3, "AATGC"}, {2, 4, "AATT"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -514,7 +514,7 @@ TEST(DBComplexVertexLoop1, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {2, 2, "AAGAA"}, {2, 3, "AATGC"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -555,7 +555,7 @@ TEST(DBComplexVertexLoop2, Basic) {
         {2, 3, "AATGC"},
         {4, 2, "GGAA"},
         {2, 5, "AATG"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -598,7 +598,7 @@ TEST(DBComplexVertexLoop3, Basic) {
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {2, 2, "AAGAA"}, {2, 3, "AATGC"},
         {4, 2, "GGAA"}, {2, 2, "AAA"}, {2, 5, "AATG"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -639,7 +639,7 @@ TEST(DBComplexVertexLoop4, Basic) {
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "ACAAA"}, {1, 1, "AAGAA"}, {1, 1, "AACAA"},
         {1, 1, "AATAA"}, {1, 1, "AAAAA"}, {1, 2, "AATGC"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -685,7 +685,7 @@ TEST(DBComplexVertexLoop5, Basic) {
         {1, 4, "AATGC"},  // 7
         {5, 1, "ACAAA"},  // 8
         {1, 6, "AATGC"}}; // 9
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -735,7 +735,7 @@ TEST(DBBuldges1, Basic) {
         {1, 2, "AATGC"},  // 5
         {0, 1, "ACAAA"},  // 6
         {1, 2, "AATGC"}}; // 7
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -777,7 +777,7 @@ TEST(DBComplexVertexConn4, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {1, 2, "GGAAA"}, {2, 3, "AATGC"}, {2, 4, "AATT"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -820,7 +820,7 @@ TEST(DBComplexVertexConn3, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {1, 2, "GGAAA"}, {2, 3, "AATGC"}, {2, 4, "AATT"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -865,7 +865,7 @@ TEST(DBComplexVertexConn3_2, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 2, "ACAAA"}, {1, 2, "GGAAA"}, {2, 3, "AATGC"}, {2, 4, "AATT"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -910,7 +910,7 @@ TEST(DBComplexVertexLoop6, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "ACAAA"}, {1, 1, "AAGAA"}, {1, 2, "AATGC"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -950,7 +950,7 @@ TEST(DBComplexVertexLoop7, Basic) {
         // {0, 1, "ACAAA"},
         {1, 1, "AAGAA"}};
     // {1, 2, "AATGC"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -987,7 +987,7 @@ TEST(DBComplexVertexLoop8, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "ACAAA"}, {1, 1, "AAGAA"}, {1, 2, "AATGC"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -1037,7 +1037,7 @@ TEST(DBComplexVertexLoop9RC, Basic) {
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "ACAAA"}, {1, 1, "AACGTTGCAA"}, {1, 2, "AATGC"},
         {3, 4, "GCATT"}, {4, 4, "TTGCAACGTT"}, {4, 5, "TTTGT"},};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -1094,7 +1094,7 @@ TEST(DBDoubleLoopRC, Basic) {
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 0, "AACGTCGCAA"}, {1, 1, "TTGCGACGTT"},
         {0, 0, "AAA"}, {1, 1, "TTT"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -1142,7 +1142,7 @@ TEST(DBIsolate, Basic) {
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info{
         {0, 1, "ACA"}};
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
@@ -1174,7 +1174,7 @@ TEST(DBEmptyGraph, Basic) {
     const size_t k = 2;
 
     std::vector<std::tuple<uint64_t, uint64_t, std::string>> raw_edge_info;
-    std::map<RRVertexType, dbg::Vertex> vertexes;
+    std::map<RRVertexType, dbg::VertexPair> vertexes;
     std::vector<dbg::Edge> edges;
     std::vector<SuccinctEdgeInfo> edge_info =
         GetEdgeInfo(vertexes, edges, raw_edge_info, k, false);
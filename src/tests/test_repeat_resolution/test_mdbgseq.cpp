@@ -24,7 +24,7 @@ TEST(RC, Basic) {
 TEST(EdgeSegment, Basic) {
     Sequence seq("AATTCCGG");
     uint64_t k = 2;
-    Vertex st(0);
+    VertexPair st(0);
     st.seq = seq.Prefix(k);
     dbg::Edge edge(&st, nullptr, seq.Suffix(seq.size() - k));
     EdgeSegment segm(&edge, 0, seq.size());
@@ -61,7 +61,7 @@ TEST(EdgeSegment, Basic) {
 TEST(MDBGSeq, SingleSegment) {
     Sequence s1("ACGT");
     uint64_t k = 2;
-    Vertex st(0);
+    VertexPair st(0);
     st.seq = s1.Prefix(k);
     dbg::Edge edge1(&st, nullptr, s1.Subseq(k));
     MDBGSeq seq1(&edge1, 0, s1.size());
@@ -90,20 +90,20 @@ TEST(MDBGSeq, SeveralSegments) {
     uint64_t k = 2;
 
     Sequence s1("ACGT");
-    Vertex st1(0);
+    VertexPair st1(0);
     st1.seq = s1.Prefix(k);
     dbg::Edge edge1(&st1, nullptr, s1.Subseq(k));
     MDBGSeq seq1(&edge1, 0, s1.size());
 
     Sequence s2("ACC");
-    Vertex st2(0);
+    VertexPair st2(0);
     st2.seq = s2.Prefix(k);
     dbg::Edge edge2(&st2, nullptr, s2.Subseq(k));
     MDBGSeq seq2(&edge2, 0, s2.size());
     seq1.Append(std::move(seq2));
 
     Sequence s3("TGA");
-    Vertex st3(0);
+    VertexPair st3(0);
     st3.seq = s3.Prefix(k);
     dbg::Edge edge3(&st3, nullptr, s3.Subseq(k));
     MDBGSeq seq3(&edge3, 0, s3.size());
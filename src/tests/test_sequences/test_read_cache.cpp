@@ -0,0 +1,36 @@
+#include "gtest/gtest.h"
+#include "sequences/seqio.hpp"
+#include "common/logging.hpp"
+#include <cstdlib>
+#include <fstream>
+
+TEST(ReadCacheTest, MatchesRawReads) {
+    StringContig::homopolymer_compressing = true;
+    StringContig::SetDimerParameters("32,32,1");
+    std::experimental::filesystem::path dir = std::experimental::filesystem::temp_directory_path() /
+            ("read_cache_test_" + std::to_string(getpid()));
+    std::experimental::filesystem::create_directories(dir);
+    std::vector<std::string> seqs = {"ACNAG", "NNNACGTNNA", "acgtnnnnccA", "ACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTTTTTTN",
+                                     "GGGGNAAAANCCCCNTTTT", "N"};
+    {
+        std::ofstream os(dir / "reads.fasta");
+        for(size_t i = 0; i < seqs.size(); i++)
+            os << ">read" << i << " comment\n" << seqs[i] << "\n";
+    }
+    logging::Logger logger;
+    io::Library raw = {dir / "reads.fasta"};
+    io::Library cached = io::CacheReads(raw, dir / "reads.rcache", logger);
+    std::vector<StringContig> raw_reads = io::SeqReader(raw).readAll();
+    std::vector<StringContig> cached_reads = io::SeqReader(cached).readAll();
+    ASSERT_EQ(raw_reads.size(), seqs.size());
+    ASSERT_EQ(cached_reads.size(), seqs.size());
+    for(size_t i = 0; i < seqs.size(); i++) {
+        ASSERT_EQ(raw_reads[i].id, cached_reads[i].id);
+        Sequence expected = raw_reads[i].makeSequence();
+        ASSERT_EQ(expected.str(), cached_reads[i].makeSequence().str());
+        ASSERT_EQ(expected.size(), cached_reads[i].size());
+    }
+    ASSERT_EQ(StringContig(std::string("ACNAG"), "read").makeSequence().str(), "ACAAG");
+    ASSERT_EQ(cached_reads[0].makeSequence().str(), "ACAAG");
+    std::experimental::filesystem::remove_all(dir);
+}
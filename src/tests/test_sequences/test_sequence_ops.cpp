@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "sequences/sequence.hpp"
+#include <random>
+
+//Word-parallel primitives of Sequence are compared with nucleotide by nucleotide implementations on random sequences
+//with arbitrary offsets and orientations.
+namespace {
+    size_t scalarCommonPrefix(const Sequence &a, const Sequence &b) {
+        size_t res = 0;
+        while(res < a.size() && res < b.size() && a[res] == b[res])
+            res += 1;
+        return res;
+    }
+
+    bool scalarEquals(const Sequence &a, const Sequence &b) {
+        if(a.size() != b.size())
+            return false;
+        for(size_t i = 0; i < a.size(); i++)
+            if(a[i] != b[i])
+                return false;
+        return true;
+    }
+
+    bool scalarLess(const Sequence &a, const Sequence &b) {
+        for(size_t i = 0; i < a.size(); i++) {
+            if(i == b.size())
+                return true;
+            else if(a[i] != b[i])
+                return a[i] < b[i];
+        }
+        return false;
+    }
+
+    bool scalarContains(const Sequence &a, const Sequence &b, size_t offset) {
+        for(size_t i = 0; i < b.size(); i++)
+            if(a[offset + i] != b[i])
+                return false;
+        return true;
+    }
+
+    std::vector<u_int64_t> scalarPacked(const Sequence &a) {
+        std::vector<u_int64_t> res(Sequence::PackedSize(a.size()));
+        for(size_t i = 0; i < a.size(); i++)
+            res[i >> 5u] |= u_int64_t(a[i]) << ((i & 31u) << 1u);
+        return res;
+    }
+
+    std::string randomString(std::mt19937_64 &rnd, size_t len) {
+        std::string res(len, 'A');
+        for(char &c : res)
+            c = "ACGT"[rnd() & 3u];
+        return res;
+    }
+
+//    Sequence equal to s stored with random padding in a random orientation
+    Sequence randomView(std::mt19937_64 &rnd, const std::string &s) {
+        size_t left = rnd() % 70;
+        std::string padded = randomString(rnd, left) + s + randomString(rnd, rnd() % 70);
+        if(rnd() & 1u)
+            return Sequence(padded).Subseq(left, left + s.size());
+        return (!Sequence(padded, true)).Subseq(left, left + s.size());
+    }
+}
+
+TEST(SequenceOpsTest, MatchScalarImplementation) {
+    std::mt19937_64 rnd(239);
+    const size_t max_len = 300;
+    for(size_t test = 0; test < 20000; test++) {
+        std::string s1 = randomString(rnd, rnd() % max_len);
+        std::string s2 = s1.substr(0, rnd() % (s1.size() + 1));
+        if(!s2.empty() && (rnd() & 1u))
+            s2[rnd() % s2.size()] = "ACGT"[rnd() & 3u];
+        s2 += randomString(rnd, rnd() % 3 == 0 ? rnd() % max_len : 0);
+        if(rnd() & 1u)
+            std::swap(s1, s2);
+        Sequence a = randomView(rnd, s1);
+        Sequence b = randomView(rnd, s2);
+        ASSERT_EQ(a.str(), s1);
+        ASSERT_EQ(b.str(), s2);
+        size_t ms = std::min(a.size(), b.size());
+        ASSERT_EQ(a.commonPrefix(b), scalarCommonPrefix(a, b)) << s1 << " " << s2;
+        ASSERT_EQ(a == b, scalarEquals(a, b)) << s1 << " " << s2;
+        ASSERT_EQ(a < b, scalarLess(a, b)) << s1 << " " << s2;
+        ASSERT_EQ(b < a, scalarLess(b, a)) << s1 << " " << s2;
+        ASSERT_EQ(a.startsWith(b), b.size() <= a.size() && scalarEquals(a.Subseq(0, b.size()), b)) << s1 << " " << s2;
+        ASSERT_EQ(a.endsWith(b), b.size() <= a.size() && scalarEquals(a.Subseq(a.size() - b.size()), b)) << s1 << " " << s2;
+        ASSERT_EQ(a.nonContradicts(b), scalarEquals(a.Subseq(0, ms), b.Subseq(0, ms))) << s1 << " " << s2;
+        if(b.size() <= a.size()) {
+            size_t offset = rnd() % (a.size() - b.size() + 1);
+            ASSERT_EQ(a.contains(b, offset), scalarContains(a, b, offset)) << s1 << " " << s2 << " " << offset;
+        }
+        std::vector<u_int64_t> packed;
+        a.writePacked(packed);
+        ASSERT_EQ(packed, scalarPacked(a)) << s1;
+        ASSERT_EQ((a + b).str(), s1 + s2);
+        size_t cut = rnd() % (b.size() + 1);
+        SequenceBuilder sb;
+        sb.append(a).append(b.Subseq(cut)).append(s1).append('G');
+        ASSERT_EQ(sb.BuildSequence().str(), s1 + s2.substr(cut) + s1 + "G");
+    }
+}
@@ -7,9 +7,12 @@
 //#include <cmath>
 //#include <cstddef>
 //#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <limits>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 
@@ -669,4 +672,124 @@ public:
         }
         inserted_element_count_ += b.size();
     }
-};
\ No newline at end of file
+};
+
+//Split block bloom filter: all bits of a key lie in one 64-byte block, one bit in each of its 8 words.
+//A query touches a single cache line, so neighbouring queries can be prefetched together with containsAll.
+//Inserts from several threads are safe. Inserted keys are not counted, so that threads do not share a counter;
+//count_bits shows how full the filter is.
+class BlockedBloomFilter {
+private:
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+    static constexpr uint32_t salt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                         0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    std::vector<Block> blocks;
+
+    template<class T>
+    static uint64_t mix(const T &t) {
+        // Note: T must be a C++ POD type.
+        static_assert(std::is_trivially_copyable<T>::value, "Key must be trivially copyable");
+        uint64_t words[(sizeof(T) + 7) / 8] = {};
+        std::memcpy(words, &t, sizeof(T));
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+        for(uint64_t w : words) {
+            h = (h ^ w) * 0xff51afd7ed558ccdULL;
+            h ^= h >> 33u;
+        }
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33u;
+        return h;
+    }
+
+    size_t blockIndex(uint64_t h) const {
+        return size_t((static_cast<unsigned __int128>(h >> 32u) * blocks.size()) >> 32u);
+    }
+
+    static uint64_t bit(uint64_t h, size_t i) {
+        return uint64_t(1) << ((uint32_t(h) * salt[i]) >> 26u);
+    }
+
+    bool test(uint64_t h) const {
+        const Block &block = blocks[blockIndex(h)];
+        bool res = true;
+        for(size_t i = 0; i < 8; i++) {
+            uint64_t mask = bit(h, i);
+            res &= (block.words[i] & mask) == mask;
+        }
+        return res;
+    }
+
+public:
+    explicit BlockedBloomFilter(const bloom_parameters& p) :
+            blocks(std::max<size_t>((p.optimal_parameters.table_size + 511) / 512, 1)) {
+    }
+
+    BlockedBloomFilter(const BlockedBloomFilter &) = delete;
+
+    template<class T>
+    void insert(const T& t) {
+        uint64_t h = mix(t);
+        Block &block = blocks[blockIndex(h)];
+        for(size_t i = 0; i < 8; i++) {
+            uint64_t mask = bit(h, i);
+            uint64_t val;
+#pragma omp atomic read
+            val = block.words[i];
+            if((val & mask) != mask) {
+#pragma omp atomic update
+                block.words[i] |= mask;
+            }
+        }
+    }
+
+    template<class T>
+    bool contains(const T& t) const {
+        return test(mix(t));
+    }
+
+//    Answers queries in groups of 16. All blocks of a group are prefetched before the first one is tested.
+    template<class T>
+    void containsAll(const T *keys, size_t n, bool *res) const {
+        const size_t group = 16;
+        uint64_t h[group];
+        for(size_t start = 0; start < n; start += group) {
+            size_t cnt = std::min(group, n - start);
+            for(size_t i = 0; i < cnt; i++) {
+                h[i] = mix(keys[start + i]);
+                __builtin_prefetch(&blocks[blockIndex(h[i])]);
+            }
+            for(size_t i = 0; i < cnt; i++) {
+                res[start + i] = test(h[i]);
+            }
+        }
+    }
+
+    std::pair<size_t, size_t> count_bits() const {
+        size_t res = 0;
+        for(const Block &block : blocks) {
+            for(uint64_t w : block.words)
+                res += __builtin_popcountll(w);
+        }
+        return {res, blocks.size() * 512};
+    }
+
+//    Fraction of random keys that are reported as present
+    double sampled_fpp(size_t samples = 1000000) const {
+        size_t hits = 0;
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for(size_t i = 0; i < samples; i++) {
+            state ^= state << 13u;
+            state ^= state >> 7u;
+            state ^= state << 17u;
+            hits += test(mix(state));
+        }
+        return double(hits) / samples;
+    }
+
+    unsigned long long int size() const {
+        return blocks.size() * 512;
+    }
+};
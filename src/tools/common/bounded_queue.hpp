@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+//Blocking queue of limited capacity for passing data between a producer thread and its consumers.
+//After close() push fails and pop returns remaining items and then fails.
+template<class T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+public:
+    explicit BoundedQueue(size_t _capacity) : capacity(_capacity) {
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+
+    bool push(T &&item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] {return closed || items.size() < capacity;});
+        if(closed)
+            return false;
+        items.emplace_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] {return closed || !items.empty();});
+        if(items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
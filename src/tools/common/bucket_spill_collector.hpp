@@ -0,0 +1,158 @@
+#pragma once
+#include "verify.hpp"
+#include "dir_utils.hpp"
+#include <parallel/algorithm>
+#include <experimental/filesystem>
+#include <omp.h>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Collects values from several threads and returns sorted unique values with bounded memory usage.
+//When buffer of a thread exceeds its share of memory limit, buffer is sorted, deduplicated and appended to bucket files.
+//Values are assigned to buckets by a mix of their bits, so that buckets have similar sizes even for skewed values
+//such as minimal hashes. Result of a spilled collection is unique but sorted only within each bucket.
+template<class T>
+class BucketSpillCollector {
+private:
+    std::experimental::filesystem::path dir;
+    size_t bucket_bits;
+    size_t thread_limit;
+    std::vector<std::vector<T>> buffers;
+    std::vector<FILE *> files;
+    std::vector<std::mutex> locks;
+    std::atomic<size_t> spilled{0};
+
+    size_t bucket(const T &val) const {
+        uint64_t x = uint64_t(val) ^ uint64_t(val >> (sizeof(T) * 4));
+        return size_t((x * 0x9E3779B97F4A7C15ull) >> (64 - bucket_bits));
+    }
+
+    std::experimental::filesystem::path bucketFile(size_t b) const {
+        return dir / ("bucket_" + std::to_string(b) + ".bin");
+    }
+
+    void readBucket(size_t b, T *out, size_t cnt) const {
+        FILE *f = fopen(bucketFile(b).c_str(), "rb");
+        VERIFY_MSG(f != nullptr && fread(out, sizeof(T), cnt, f) == cnt, "Failed to read spill file " + bucketFile(b).string());
+        fclose(f);
+    }
+
+    void rewriteBucket(size_t b, const std::vector<T> &vals) const {
+        FILE *f = fopen(bucketFile(b).c_str(), "wb");
+        VERIFY_MSG(f != nullptr && fwrite(vals.data(), sizeof(T), vals.size(), f) == vals.size(),
+                   "Failed to write spill file " + bucketFile(b).string());
+        fclose(f);
+    }
+
+    void spill(std::vector<T> &buf) {
+        std::sort(buf.begin(), buf.end());
+        buf.erase(std::unique(buf.begin(), buf.end()), buf.end());
+        auto it = buf.begin();
+        while(it != buf.end()) {
+            size_t b = bucket(*it);
+            auto end = it;
+            while(end != buf.end() && bucket(*end) == b)
+                ++end;
+            std::lock_guard<std::mutex> lock(locks[b]);
+            if(files[b] == nullptr) {
+                files[b] = fopen(bucketFile(b).c_str(), "wb");
+                VERIFY_MSG(files[b] != nullptr, "Failed to create spill file " + bucketFile(b).string());
+            }
+            size_t cnt = end - it;
+            VERIFY_MSG(fwrite(&*it, sizeof(T), cnt, files[b]) == cnt, "Failed to write spill file " + bucketFile(b).string());
+            it = end;
+        }
+        spilled += buf.size() * sizeof(T);
+        buf.clear();
+    }
+
+public:
+//    Memory limit is given in bytes and is split between thread buffers. Zero limit disables spilling.
+    BucketSpillCollector(std::experimental::filesystem::path _dir, size_t threads, size_t memory_limit, size_t _bucket_bits = 8) :
+            dir(std::move(_dir)), bucket_bits(_bucket_bits), thread_limit(memory_limit / threads / 2),
+            buffers(threads), files(size_t(1) << bucket_bits, nullptr), locks(size_t(1) << bucket_bits) {
+        if(thread_limit > 0)
+            ensure_dir_existance(dir);
+    }
+
+    BucketSpillCollector(const BucketSpillCollector &) = delete;
+
+    template<class I>
+    void addAll(I begin, I end) {
+        std::vector<T> &buf = buffers[omp_get_thread_num()];
+        buf.insert(buf.end(), begin, end);
+        if(thread_limit > 0 && buf.size() * sizeof(T) >= thread_limit)
+            spill(buf);
+    }
+
+    size_t size() const {
+        size_t res = 0;
+        for(const std::vector<T> &buf : buffers)
+            res += buf.size();
+        return res;
+    }
+
+//    Total size in bytes of values written to disk
+    size_t spilledBytes() const {
+        return spilled;
+    }
+
+    std::vector<T> collectUnique(size_t threads) {
+        if(spilled == 0) {
+            std::vector<T> res;
+            for(std::vector<T> &buf : buffers) {
+                res.insert(res.end(), buf.begin(), buf.end());
+                std::vector<T>().swap(buf);
+            }
+            __gnu_parallel::sort(res.begin(), res.end());
+            res.erase(std::unique(res.begin(), res.end()), res.end());
+            return std::move(res);
+        }
+        omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(dynamic, 1)
+        for(size_t i = 0; i < buffers.size(); i++) {
+            spill(buffers[i]);
+            std::vector<T>().swap(buffers[i]);
+        }
+//        Buckets are deduplicated and written back one per thread, so at most threads buckets are in memory. Then the
+//        result of known size is read from the deduplicated files.
+        std::vector<size_t> counts(files.size(), 0);
+#pragma omp parallel for default(none) shared(counts) schedule(dynamic, 1)
+        for(size_t b = 0; b < files.size(); b++) {
+            if(files[b] == nullptr)
+                continue;
+            fclose(files[b]);
+            files[b] = nullptr;
+            std::vector<T> vals(std::experimental::filesystem::file_size(bucketFile(b)) / sizeof(T));
+            readBucket(b, vals.data(), vals.size());
+            std::sort(vals.begin(), vals.end());
+            vals.erase(std::unique(vals.begin(), vals.end()), vals.end());
+            rewriteBucket(b, vals);
+            counts[b] = vals.size();
+        }
+        std::vector<size_t> offsets(files.size() + 1, 0);
+        for(size_t b = 0; b < files.size(); b++)
+            offsets[b + 1] = offsets[b] + counts[b];
+        std::vector<T> res(offsets.back());
+#pragma omp parallel for default(none) shared(counts, offsets, res) schedule(dynamic, 1)
+        for(size_t b = 0; b < files.size(); b++) {
+            if(counts[b] == 0)
+                continue;
+            readBucket(b, res.data() + offsets[b], counts[b]);
+            std::experimental::filesystem::remove(bucketFile(b));
+        }
+        return std::move(res);
+    }
+
+    ~BucketSpillCollector() {
+        for(size_t b = 0; b < files.size(); b++) {
+            if(files[b] != nullptr) {
+                fclose(files[b]);
+                std::experimental::filesystem::remove(bucketFile(b));
+            }
+        }
+    }
+};
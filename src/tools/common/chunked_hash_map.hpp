@@ -0,0 +1,466 @@
+#pragma once
+
+#include "verify.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class HashIndexType {chained, open_addressing};
+
+inline HashIndexType parseHashIndexType(const std::string &s) {
+    if(s == "chained")
+        return HashIndexType::chained;
+    VERIFY_MSG(s == "open", "Unknown hash index type " + s + ". Expected open or chained");
+    return HashIndexType::open_addressing;
+}
+
+inline std::string hashIndexTypeName(HashIndexType type) {
+    return type == HashIndexType::chained ? "chained" : "open";
+}
+
+//Hash map that never moves its values. Values are placed into fixed size chunks and only the index over them is rebuilt
+//when the map grows, so pointers and references to values stay valid until the value is erased.
+//Index is either an open addressing table of value positions or std::unordered_map from key to value position.
+//Open addressing index allows concurrent insertions and lookups as long as enough space was reserved in advance.
+template<class Key, class Value, class Hasher = std::hash<Key>>
+class ChunkedHashMap {
+public:
+    typedef std::pair<const Key, Value> value_type;
+private:
+    static constexpr size_t chunk_bits = 10;
+    static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+//    Slot states. Values larger than deleted_slot store value id shifted by first_id.
+    static constexpr size_t empty_slot = 0;
+    static constexpr size_t busy_slot = 1;
+    static constexpr size_t deleted_slot = 2;
+    static constexpr size_t first_id = 3;
+    static constexpr size_t max_load_percent = 70;
+
+    struct Chunk {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type entries[chunk_size];
+        unsigned char alive[chunk_size] = {};
+    };
+
+    HashIndexType index_type;
+    Hasher hasher;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    size_t next_id = 0;
+    size_t alive_cnt = 0;
+    std::vector<size_t> free_ids;
+    std::vector<size_t> slots;
+    size_t slot_bits = 0;
+    size_t used_slots = 0;
+    std::unordered_map<Key, size_t, Hasher> chained_index;
+
+    value_type *entry(size_t id) const {
+        return reinterpret_cast<value_type *>(&chunks[id >> chunk_bits]->entries[id & (chunk_size - 1)]);
+    }
+
+    bool isAlive(size_t id) const {
+        return chunks[id >> chunk_bits]->alive[id & (chunk_size - 1)] != 0;
+    }
+
+    size_t slotPosition(const Key &key) const {
+        return (size_t(hasher(key)) * 0x9E3779B97F4A7C15ull) >> (64 - slot_bits);
+    }
+
+    size_t loadRef(const size_t &slot) const {
+        size_t ref = __atomic_load_n(&slot, __ATOMIC_ACQUIRE);
+        while(ref == busy_slot) {
+            ref = __atomic_load_n(&slot, __ATOMIC_ACQUIRE);
+        }
+        return ref;
+    }
+
+    size_t findId(const Key &key) const {
+        if(index_type == HashIndexType::chained) {
+            auto it = chained_index.find(key);
+            return it == chained_index.end() ? size_t(-1) : it->second;
+        }
+        if(slots.empty())
+            return size_t(-1);
+        size_t mask = slots.size() - 1;
+        for(size_t pos = slotPosition(key);; pos = (pos + 1) & mask) {
+            size_t ref = loadRef(slots[pos]);
+            if(ref == empty_slot)
+                return size_t(-1);
+            if(ref != deleted_slot && entry(ref - first_id)->first == key)
+                return ref - first_id;
+        }
+    }
+
+    size_t idCapacity() const {
+        return chunks.size() << chunk_bits;
+    }
+
+    void reserveIds(size_t n) {
+        while(idCapacity() < n)
+            chunks.emplace_back(new Chunk());
+    }
+
+    bool fitsIndex(size_t n) const {
+        return n * 100 <= slots.size() * max_load_percent;
+    }
+
+    void rebuildIndex(size_t n) {
+        size_t new_bits = 4;
+        while((size_t(1) << new_bits) * max_load_percent < n * 100)
+            new_bits++;
+        slot_bits = new_bits;
+        slots = std::vector<size_t>(size_t(1) << slot_bits, empty_slot);
+        used_slots = 0;
+        size_t mask = slots.size() - 1;
+        for(size_t id = 0; id < next_id; id++) {
+            if(!isAlive(id))
+                continue;
+            size_t pos = slotPosition(entry(id)->first);
+            while(slots[pos] != empty_slot)
+                pos = (pos + 1) & mask;
+            slots[pos] = id + first_id;
+            used_slots++;
+        }
+    }
+
+    template<class... Args>
+    size_t construct(size_t id, const Key &key, Args&&... args) {
+        new(entry(id)) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                  std::forward_as_tuple(std::forward<Args>(args)...));
+        chunks[id >> chunk_bits]->alive[id & (chunk_size - 1)] = 1;
+        return id;
+    }
+
+//    Inserts key into open addressing index. Returns id of the existing value if the key is already present.
+//    Otherwise constructs new value with id provided by new_id.
+    template<class IdProvider, class... Args>
+    std::pair<size_t, bool> openEmplace(const IdProvider &new_id, const Key &key, Args&&... args) {
+        size_t mask = slots.size() - 1;
+        for(size_t pos = slotPosition(key);; pos = (pos + 1) & mask) {
+            size_t &slot = slots[pos];
+            size_t ref = loadRef(slot);
+            if(ref == empty_slot) {
+                size_t expected = empty_slot;
+                if(!__atomic_compare_exchange_n(&slot, &expected, busy_slot, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    ref = loadRef(slot);
+                } else {
+                    size_t id = construct(new_id(), key, std::forward<Args>(args)...);
+                    __atomic_store_n(&slot, id + first_id, __ATOMIC_RELEASE);
+                    return {id, true};
+                }
+            }
+            if(ref != deleted_slot && entry(ref - first_id)->first == key)
+                return {ref - first_id, false};
+        }
+    }
+
+    size_t serialId() {
+        if(!free_ids.empty()) {
+            size_t id = free_ids.back();
+            free_ids.pop_back();
+            return id;
+        }
+        reserveIds(next_id + 1);
+        return next_id++;
+    }
+
+    template<class V>
+    class Iterator {
+    private:
+        const ChunkedHashMap *map;
+        size_t id;
+
+        void seek() {
+            while(id < map->next_id && !map->isAlive(id))
+                id++;
+        }
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef V value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef V *pointer;
+        typedef V &reference;
+        friend class ChunkedHashMap;
+
+        Iterator(const ChunkedHashMap *_map, size_t _id) : map(_map), id(_id) {
+            seek();
+        }
+
+        template<class U>
+        Iterator(const Iterator<U> &other) : map(other.container()), id(other.position()) {}
+
+        const ChunkedHashMap *container() const {return map;}
+        size_t position() const {return id;}
+
+        reference operator*() const {return *map->entry(id);}
+        pointer operator->() const {return map->entry(id);}
+
+        Iterator &operator++() {
+            id++;
+            seek();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const Iterator &other) const {return id == other.id;}
+        bool operator!=(const Iterator &other) const {return id != other.id;}
+    };
+
+public:
+    typedef Iterator<value_type> iterator;
+    typedef Iterator<const value_type> const_iterator;
+
+    explicit ChunkedHashMap(HashIndexType _index_type = HashIndexType::open_addressing) : index_type(_index_type) {}
+    ChunkedHashMap(ChunkedHashMap &&other) noexcept : index_type(other.index_type) {
+        *this = std::move(other);
+    }
+    ChunkedHashMap &operator=(ChunkedHashMap &&other) noexcept {
+        if(this != &other) {
+            clear();
+            index_type = other.index_type;
+            hasher = std::move(other.hasher);
+            chunks = std::move(other.chunks);
+            next_id = other.next_id;
+            alive_cnt = other.alive_cnt;
+            free_ids = std::move(other.free_ids);
+            slots = std::move(other.slots);
+            slot_bits = other.slot_bits;
+            used_slots = other.used_slots;
+            chained_index = std::move(other.chained_index);
+            other.next_id = 0;
+            other.alive_cnt = 0;
+            other.used_slots = 0;
+            other.slot_bits = 0;
+        }
+        return *this;
+    }
+    ChunkedHashMap(const ChunkedHashMap &other) = delete;
+
+    ~ChunkedHashMap() {
+        clear();
+    }
+
+    HashIndexType indexType() const {return index_type;}
+    size_t size() const {return alive_cnt;}
+    bool empty() const {return alive_cnt == 0;}
+
+    iterator begin() {return {this, 0};}
+    iterator end() {return {this, next_id};}
+    const_iterator begin() const {return {this, 0};}
+    const_iterator end() const {return {this, next_id};}
+
+    iterator find(const Key &key) {
+        size_t id = findId(key);
+        return id == size_t(-1) ? end() : iterator(this, id);
+    }
+
+    const_iterator find(const Key &key) const {
+        size_t id = findId(key);
+        return id == size_t(-1) ? end() : const_iterator(this, id);
+    }
+
+    size_t count(const Key &key) const {
+        return findId(key) == size_t(-1) ? 0 : 1;
+    }
+
+//    Hints that key will be looked up soon. Batched lookups can prefetch slots for many keys before probing any of them.
+    void prefetch(const Key &key) const {
+        if(!slots.empty())
+            __builtin_prefetch(&slots[slotPosition(key)]);
+    }
+
+//    Prepares the map for n values in total. After this call up to n - size() values can be inserted concurrently.
+    void reserve(size_t n) {
+        size_t extra = n > alive_cnt ? n - alive_cnt : 0;
+        reserveIds(next_id + extra);
+        if(index_type == HashIndexType::chained) {
+            chained_index.reserve(n);
+        } else if(!fitsIndex(used_slots + extra)) {
+            rebuildIndex(std::max(n, alive_cnt + extra));
+        }
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(const Key &key, Args&&... args) {
+        if(index_type == HashIndexType::chained) {
+            auto it = chained_index.find(key);
+            if(it != chained_index.end())
+                return {iterator(this, it->second), false};
+            size_t id = construct(serialId(), key, std::forward<Args>(args)...);
+            chained_index.emplace(key, id);
+            alive_cnt++;
+            return {iterator(this, id), true};
+        }
+        if(!fitsIndex(used_slots + 1))
+            rebuildIndex(std::max<size_t>(alive_cnt * 2, 16));
+        std::pair<size_t, bool> res = openEmplace([this]() {return serialId();}, key, std::forward<Args>(args)...);
+        if(res.second) {
+            alive_cnt++;
+            used_slots++;
+        }
+        return {iterator(this, res.first), res.second};
+    }
+
+//    Thread safe version of emplace. Open addressing index requires that space for all inserted values was reserved.
+//    Chained index falls back to serialized insertion.
+    template<class... Args>
+    std::pair<iterator, bool> emplaceConcurrent(const Key &key, Args&&... args) {
+        if(index_type == HashIndexType::chained) {
+            std::pair<iterator, bool> res(end(), false);
+#pragma omp critical(chunked_hash_map_insert)
+            {
+                res = emplace(key, std::forward<Args>(args)...);
+            }
+            return res;
+        }
+        auto new_id = [this]() {
+            size_t id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+            VERIFY_MSG(id < idCapacity(), "Concurrent insertion into ChunkedHashMap exceeded reserved size");
+            return id;
+        };
+        std::pair<size_t, bool> res = openEmplace(new_id, key, std::forward<Args>(args)...);
+        if(res.second) {
+            __atomic_fetch_add(&alive_cnt, 1, __ATOMIC_RELAXED);
+            size_t used = __atomic_add_fetch(&used_slots, 1, __ATOMIC_RELAXED);
+            VERIFY_MSG(used < slots.size(), "Concurrent insertion into ChunkedHashMap exceeded reserved size");
+        }
+        return {iterator(this, res.first), res.second};
+    }
+
+//    Fills empty map with values constructed from unique keys using given number of threads. Keys may come in any order.
+//    Storage and index are allocated once for the final size and no lookups are performed. Values are stored in the order
+//    of keys, so iteration order is the order of keys and not the order of a hash table. Duplicate keys are detected
+//    when their index slots collide.
+    void bulkEmplace(const std::vector<Key> &keys, size_t threads) {
+        VERIFY(next_id == 0);
+        size_t n = keys.size();
+        reserveIds(n);
+        if(index_type == HashIndexType::open_addressing)
+            rebuildIndex(n);
+        omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(keys, n) schedule(static, 1 << 12)
+        for(size_t id = 0; id < n; id++) {
+            construct(id, keys[id], keys[id]);
+            if(index_type == HashIndexType::open_addressing) {
+                size_t mask = slots.size() - 1;
+                size_t pos = slotPosition(keys[id]);
+                size_t expected = empty_slot;
+                while(!__atomic_compare_exchange_n(&slots[pos], &expected, id + first_id, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+//                    Slot is taken by another key. Its value may still be under construction, so the key is read from input.
+                    if(keys[expected - first_id] == keys[id])
+                        VERIFY_OMP(false, "Duplicate key in ChunkedHashMap::bulkEmplace");
+                    pos = (pos + 1) & mask;
+                    expected = empty_slot;
+                }
+            }
+        }
+        next_id = n;
+        alive_cnt = n;
+        if(index_type == HashIndexType::open_addressing) {
+            used_slots = n;
+        } else {
+            chained_index.reserve(n);
+            for(size_t id = 0; id < n; id++)
+                VERIFY_MSG(chained_index.emplace(keys[id], id).second, "Duplicate key in ChunkedHashMap::bulkEmplace");
+        }
+    }
+
+    iterator erase(iterator it) {
+        size_t id = it.id;
+        VERIFY(id < next_id && isAlive(id));
+        const Key &key = entry(id)->first;
+        if(index_type == HashIndexType::chained) {
+            chained_index.erase(key);
+        } else {
+            size_t mask = slots.size() - 1;
+            size_t pos = slotPosition(key);
+            while(slots[pos] != id + first_id)
+                pos = (pos + 1) & mask;
+            slots[pos] = deleted_slot;
+        }
+        entry(id)->~value_type();
+        chunks[id >> chunk_bits]->alive[id & (chunk_size - 1)] = 0;
+        free_ids.push_back(id);
+        alive_cnt--;
+        return iterator(this, id + 1);
+    }
+
+//    Erases all values satisfying the predicate using given number of threads. Predicate is evaluated for all values
+//    before any value is destroyed, so it may look at other values of the map. Returns the number of erased values.
+    template<class Predicate>
+    size_t eraseIf(const Predicate &pred, size_t threads) {
+        std::vector<std::vector<size_t>> erased(threads);
+        omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(pred, erased) schedule(dynamic, 1)
+        for(size_t chunk = 0; chunk < chunks.size(); chunk++) {
+            std::vector<size_t> &ids = erased[omp_get_thread_num()];
+            for(size_t id = chunk << chunk_bits; id < std::min(next_id, (chunk + 1) << chunk_bits); id++) {
+                if(isAlive(id) && pred(*entry(id)))
+                    ids.push_back(id);
+            }
+        }
+        if(index_type == HashIndexType::chained) {
+            for(std::vector<size_t> &ids : erased) {
+                for(size_t id : ids)
+                    chained_index.erase(entry(id)->first);
+            }
+        }
+#pragma omp parallel for default(none) shared(erased) schedule(static, 1)
+        for(size_t i = 0; i < erased.size(); i++) {
+            for(size_t id : erased[i]) {
+                if(index_type == HashIndexType::open_addressing) {
+                    size_t mask = slots.size() - 1;
+                    size_t pos = slotPosition(entry(id)->first);
+                    while(__atomic_load_n(&slots[pos], __ATOMIC_RELAXED) != id + first_id)
+                        pos = (pos + 1) & mask;
+                    __atomic_store_n(&slots[pos], deleted_slot, __ATOMIC_RELAXED);
+                }
+                entry(id)->~value_type();
+                chunks[id >> chunk_bits]->alive[id & (chunk_size - 1)] = 0;
+            }
+        }
+//        Free ids are kept in the same order as after serial erasure so that later insertions do not depend on scheduling
+        size_t old_size = free_ids.size();
+        for(std::vector<size_t> &ids : erased)
+            free_ids.insert(free_ids.end(), ids.begin(), ids.end());
+        std::sort(free_ids.begin() + old_size, free_ids.end());
+        size_t cnt = free_ids.size() - old_size;
+        alive_cnt -= cnt;
+        return cnt;
+    }
+
+    void clear() {
+        for(size_t id = 0; id < next_id; id++) {
+            if(isAlive(id))
+                entry(id)->~value_type();
+        }
+        chunks.clear();
+        free_ids.clear();
+        slots.clear();
+        chained_index.clear();
+        next_id = 0;
+        alive_cnt = 0;
+        used_slots = 0;
+        slot_bits = 0;
+    }
+
+//    Approximate number of bytes used by the map including values but excluding memory allocated by the values themselves.
+    size_t memoryUsage() const {
+        size_t res = chunks.size() * sizeof(Chunk) + slots.size() * sizeof(size_t) + free_ids.capacity() * sizeof(size_t);
+        if(index_type == HashIndexType::chained) {
+            res += chained_index.bucket_count() * sizeof(void *);
+            res += chained_index.size() * (sizeof(std::pair<const Key, size_t>) + 2 * sizeof(void *));
+        }
+        return res;
+    }
+};
@@ -1,9 +1,18 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include <string>
 
 namespace hashing {
+//    64-bit hashes are selected with -DLJA_HASH_WIDTH=64. They are faster and take half the memory but collisions
+//    become possible for large genomes. SparseDBG aborts if it finds two different vertex k-mers with the same hash.
+//    Lookups of read k-mers compare sequences and skip k-mers that only share the hash of a vertex or an anchor.
+#ifdef LJA_HASH64
+    typedef uint64_t htype;
+#else
     typedef unsigned __int128 htype;
+#endif
 
     template<class Key>
     struct alt_hasher {
@@ -13,11 +22,16 @@ namespace hashing {
     template<>
     struct alt_hasher<htype> {
         size_t operator()(const htype &x) const {
+#ifdef LJA_HASH64
+            return (size_t(x) * 31) ^ size_t(x >> 32u);
+#else
             return (size_t(x) * 31) ^ size_t(x >> 64u);
+#endif
         }
     };
 }
 
+#ifndef LJA_HASH64
 inline std::ostream &operator<<(std::ostream &os, hashing::htype val) {
     std::vector<size_t> res;
     while (val != 0) {
@@ -39,3 +53,4 @@ inline std::istream &operator>>(std::istream &is, hashing::htype &val) {
     }
     return is;
 }
+#endif
@@ -6,7 +6,9 @@
 #include <parallel/algorithm>
 #include <omp.h>
 #include <utility>
+#include <iterator>
 #include <numeric>
+#include <chrono>
 #include <wait.h>
 #include "unistd.h"
 
@@ -38,7 +40,13 @@ class ParallelRecordCollector {
     std::vector<std::vector<T>> recs;
 public:
     friend class Iterator;
-    class Iterator : public std::iterator<std::forward_iterator_tag, T, size_t,  T*, T&>{
+    class Iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef size_t difference_type;
+        typedef T *pointer;
+        typedef T &reference;
     private:
         ParallelRecordCollector<T> &data;
         size_t row;
@@ -156,6 +164,8 @@ public:
     std::function<void ()> doInTheEnd = [] () {};
     logging::Logger &logger;
     size_t threads;
+//    Total length of items that are read into memory and processed between calls of doBefore and doAfter
+    size_t max_batch_length = 1024 * 1024 * 1024;
 
     ParallelProcessor(std::function<void(size_t, V &)> _task, logging::Logger & _logger, size_t _threads) :
                     task(_task), logger(_logger), threads(_threads) {
@@ -175,10 +185,11 @@ public:
         };
 //        size_t bucket_length = 1024 * 1024;
         size_t buffer_size = 1024 * 1024;
-        size_t max_length = 1024 * 1024 * 1024;
+        size_t max_length = max_batch_length;
         ParallelProcessor<V> &self = *this;
         size_t total = 0;
         size_t total_len = 0;
+        auto start_time = std::chrono::steady_clock::now();
         while(begin != end) {
             size_t clen = 0;
             std::vector<V> items;
@@ -221,8 +232,10 @@ public:
             total_len += clen;
         }
         doInTheEnd();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
         logger.trace() << "Finished parallel processing. Processed " << total <<
-               " items with total length " << total_len << std::endl;
+               " items with total length " << total_len << " at " << size_t(total_len / std::max(seconds, 1e-3) / 1000000) <<
+               " Mb/s" << std::endl;
     }
 
 
@@ -5,7 +5,9 @@
 
 #include "common/hash_utils.hpp"
 #include "sequences/sequence.hpp"
+#include <algorithm>
 #include <deque>
+#include <vector>
 
 namespace hashing {
     template<typename T, typename U>
@@ -37,6 +39,18 @@ namespace hashing {
             return k;
         }
 
+        htype base() const {
+            return hbase;
+        }
+
+        htype basePower() const {
+            return kpow;
+        }
+
+        htype inverseBase() const {
+            return inv;
+        }
+
         RollingHash extensionHash() const {
             return RollingHash(k + 1, hbase);
         }
@@ -82,8 +96,11 @@ namespace hashing {
         }
     };
 
+    class KmerHashStream;
+
     class KWH {
     private:
+        friend class KmerHashStream;
         KWH(const RollingHash &_hasher, const Sequence &_seq, size_t _pos, htype _fhash, htype _rhash) :
                 hasher(_hasher), seq(_seq), pos(_pos), fhash(_fhash), rhash(_rhash) {
         }
@@ -166,6 +183,96 @@ namespace hashing {
     };
 
 
+//    Rolling step shared by KmerHashStream and MinimizerKernel. Forward and reverse complement hashes of consecutive k-mers
+//    are updated together and nucleotides are taken directly from 2-bit packed words. Values are the same as in KWH::next.
+    class PackedKmerRoller {
+    private:
+        size_t k;
+        htype hbase;
+        htype inv;
+        htype fsub[4];
+        htype radd[4];
+        std::vector<u_int64_t> words;
+    public:
+        htype fhash = 0;
+        htype rhash = 0;
+
+        explicit PackedKmerRoller(const RollingHash &hasher) : k(hasher.getK()), hbase(hasher.base()),
+                                                               inv(hasher.inverseBase()) {
+            for(unsigned char c = 0; c < 4; c++) {
+                fsub[c] = hasher.basePower() * c;
+                radd[c] = hasher.basePower() * (3u - c);
+            }
+        }
+
+        unsigned char nucl(size_t i) const {
+            return (words[i >> 5u] >> ((i & 31u) << 1u)) & 3u;
+        }
+
+//        Packs seq and computes hashes of its first k-mer. Buffer is reused between calls.
+        void reset(const Sequence &seq) {
+            words.clear();
+            seq.writePacked(words);
+            fhash = 0;
+            rhash = 0;
+            htype pw = 1;
+            for(size_t i = 0; i < k; i++) {
+                unsigned char c = nucl(i);
+                fhash = fhash * hbase + c;
+                rhash += pw * (3u - c);
+                pw *= hbase;
+            }
+        }
+
+//        Moves hashes from k-mer at position pos to k-mer at position pos + 1
+        void roll(size_t pos) {
+            unsigned char out = nucl(pos);
+            unsigned char in = nucl(pos + k);
+            fhash = (fhash - fsub[out]) * hbase + in;
+            rhash = (rhash - (3u - out)) * inv + radd[in];
+        }
+    };
+
+//    Computes hashes of consecutive k-mers of a sequence block by block with the same values as KWH::next. No KWH objects
+//    are created, so a caller can compute hashes for a block of positions and prefetch index entries for all of them
+//    before the lookups.
+    class KmerHashStream {
+    private:
+        const RollingHash &hasher;
+        Sequence seq;
+        PackedKmerRoller roller;
+        size_t pos = 0;
+        size_t kmers;
+
+    public:
+        KmerHashStream(const RollingHash &_hasher, const Sequence &_seq) : hasher(_hasher), seq(_seq), roller(_hasher),
+                kmers(_seq.size() >= _hasher.getK() ? _seq.size() - _hasher.getK() + 1 : 0) {
+            if(kmers > 0)
+                roller.reset(seq);
+        }
+
+        bool hasNext() const {return pos < kmers;}
+//        Position of the first k-mer that will be returned by the next call of next
+        size_t position() const {return pos;}
+
+//        Writes forward and reverse complement hashes of up to cnt next k-mers and returns the number of written k-mers
+        size_t next(htype *fhashes, htype *rhashes, size_t cnt) {
+            cnt = std::min(cnt, kmers - pos);
+            for(size_t i = 0; i < cnt; i++) {
+                fhashes[i] = roller.fhash;
+                rhashes[i] = roller.rhash;
+                pos++;
+                if(pos < kmers)
+                    roller.roll(pos - 1);
+            }
+            return cnt;
+        }
+
+        KWH kwh(size_t kmer_pos, htype kmer_fhash, htype kmer_rhash) const {
+            return {hasher, seq, kmer_pos, kmer_fhash, kmer_rhash};
+        }
+    };
+
     class MinQueue {
         std::deque<KWH> q;
     public:
@@ -252,4 +359,56 @@ namespace hashing {
             return std::move(res);
         }
     };
-}
\ No newline at end of file
+
+//    Computes the same hashes as MinimizerCalculator::minimizerHashs without creating KWH objects. Hashes are rolled with
+//    PackedKmerRoller and sliding minimum is kept in a fixed ring buffer. Buffers are reused between calls, so one kernel
+//    should be created per thread.
+    class MinimizerKernel {
+    private:
+        const RollingHash &hasher;
+        size_t w;
+        PackedKmerRoller roller;
+        std::vector<htype> ring_hash;
+        std::vector<size_t> ring_pos;
+        size_t mask;
+
+    public:
+        MinimizerKernel(const RollingHash &_hasher, size_t _w) : hasher(_hasher), w(_w), roller(_hasher) {
+            VERIFY(w >= 2);
+            size_t capacity = 1;
+            while(capacity < w + 2)
+                capacity *= 2;
+            ring_hash.resize(capacity);
+            ring_pos.resize(capacity);
+            mask = capacity - 1;
+        }
+
+        void minimizerHashs(const Sequence &seq, std::vector<htype> &res) {
+            size_t k = hasher.getK();
+            size_t n = seq.size();
+            VERIFY(n >= k + w - 1);
+            res.clear();
+            roller.reset(seq);
+            size_t head = 0;
+            size_t tail = 0;
+            for(size_t pos = 0; pos + k <= n; pos++) {
+                if(pos > 0)
+                    roller.roll(pos - 1);
+//                Windows after the first one cover w + 1 k-mers, same as in MinimizerCalculator
+                if(pos >= w && ring_pos[head & mask] < pos - w)
+                    head++;
+                htype val = std::min(roller.fhash, roller.rhash);
+                while(tail > head && ring_hash[(tail - 1) & mask] > val)
+                    tail--;
+                ring_hash[tail & mask] = val;
+                ring_pos[tail & mask] = pos;
+                tail++;
+                if(pos + 1 >= w) {
+                    htype min = ring_hash[head & mask];
+                    if(res.empty() || res.back() != min)
+                        res.push_back(min);
+                }
+            }
+        }
+    };
+}
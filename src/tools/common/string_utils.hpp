@@ -40,12 +40,12 @@ static bool startsWith(const std::string& str, const std::string& prefix)
 
 static inline void ltrim_inplace(std::string &s) {
     s.erase(s.begin(), std::find_if(s.begin(), s.end(),
-                                    std::not1(std::ptr_fun<int, int>(std::isspace))));
+                                    [](int c) {return !std::isspace(c);}));
 }
 
 static inline void rtrim_inplace(std::string &s) {
     s.erase(std::find_if(s.rbegin(), s.rend(),
-                         std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
+                         [](int c) {return !std::isspace(c);}).base(), s.end());
 }
 
 static inline std::string trim(std::string s) {
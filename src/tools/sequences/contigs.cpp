@@ -10,7 +10,7 @@ size_t StringContig::max_dimer_size = 1000000000;
 size_t StringContig::dimer_step = 1;
 
 void StringContig::compress() {
-    if(!homopolymer_compressing)
+    if(!homopolymer_compressing || !packed.empty())
         return;
     seq.erase(std::unique(seq.begin(), seq.end()), seq.end());
     VERIFY(min_dimer_to_compress <= max_dimer_size);
@@ -262,6 +262,9 @@ public:
     std::string id;
     std::string comment;
     std::string seq;
+//    Reads loaded from read cache are already compressed and stored in 2-bit form. For them seq is empty and compress
+//    does nothing.
+    Sequence packed;
     static bool homopolymer_compressing;
     static size_t min_dimer_to_compress;
     static size_t max_dimer_size;
@@ -280,6 +283,9 @@ public:
     StringContig(std::string && _seq, std::string &&_id) : id(extractId(_id)), comment(extractComment(_id)), seq(makeUpperCase(std::move(_seq))) {
     }
 
+    StringContig(Sequence _packed, std::string &&_id) : id(extractId(_id)), comment(extractComment(_id)), packed(std::move(_packed)) {
+    }
+
     StringContig(StringContig && other) = default;
 
     StringContig(const StringContig & other) = default;
@@ -305,7 +311,7 @@ public:
 
     Contig makeContig() {
         compress();
-        return Contig(Sequence(seq), id);
+        return Contig(packed.empty() ? Sequence(seq) : packed, id);
     }
 
 //    Contig makeCompressedContig() {
@@ -315,7 +321,7 @@ public:
 
     Sequence makeSequence() {
         compress();
-        return Sequence(seq);
+        return packed.empty() ? Sequence(seq) : packed;
     }
 
 //    Sequence makeCompressedSequence() {
@@ -324,11 +330,11 @@ public:
 //    }
 
     bool isNull() const {
-        return id.empty() && seq.empty();
+        return id.empty() && seq.empty() && packed.empty();
     }
 
     size_t size() const {
-        return seq.size();
+        return packed.empty() ? seq.size() : packed.size();
     }
 };
 
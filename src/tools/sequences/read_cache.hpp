@@ -0,0 +1,159 @@
+#pragma once
+
+#include "contigs.hpp"
+#include "sequence.hpp"
+#include "common/string_utils.hpp"
+#include "common/verify.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <experimental/filesystem>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace io {
+
+//    Binary cache of reads that were already compressed with StringContig::compress. Reads are loaded as packed
+//    sequences, so they are neither decoded to text nor compressed again.
+//    Layout: header, read records and index of record offsets. Each record consists of sequence length, id length,
+//    id padded to 8 bytes and 2-bit packed sequence. Header is written last so an interrupted conversion is never reused.
+    class ReadCache {
+    public:
+        struct Header {
+            char magic[8];
+            uint64_t reads;
+            uint64_t index_offset;
+            uint64_t fingerprint;
+            uint64_t homopolymer_compressing;
+            uint64_t min_dimer_to_compress;
+            uint64_t max_dimer_size;
+            uint64_t dimer_step;
+        };
+
+        static constexpr char magic[8] = {'L', 'J', 'A', 'R', 'C', 'H', 'E', '1'};
+
+        static bool IsCache(const std::experimental::filesystem::path &file_name) {
+            return endsWith(file_name, ".rcache");
+        }
+
+//        Depends on names and sizes of library files and on current compression parameters
+        static Header MakeHeader(const std::vector<std::experimental::filesystem::path> &lib) {
+            std::stringstream ss;
+            for(const std::experimental::filesystem::path &file_name : lib) {
+                ss << std::experimental::filesystem::absolute(file_name).string() << ":" <<
+                   std::experimental::filesystem::file_size(file_name) << ";";
+            }
+            Header header = {};
+            std::copy(magic, magic + 8, header.magic);
+            header.fingerprint = std::hash<std::string>()(ss.str());
+            header.homopolymer_compressing = StringContig::homopolymer_compressing;
+            header.min_dimer_to_compress = StringContig::min_dimer_to_compress;
+            header.max_dimer_size = StringContig::max_dimer_size;
+            header.dimer_step = StringContig::dimer_step;
+            return header;
+        }
+
+        static bool Matches(const std::experimental::filesystem::path &file_name, const Header &expected) {
+            if(!std::experimental::filesystem::is_regular_file(file_name))
+                return false;
+            Header header = {};
+            std::ifstream is(file_name, std::ios::binary);
+            is.read(reinterpret_cast<char *>(&header), sizeof(header));
+            return !is.fail() && std::equal(magic, magic + 8, header.magic) &&
+                   header.fingerprint == expected.fingerprint &&
+                   header.homopolymer_compressing == expected.homopolymer_compressing &&
+                   header.min_dimer_to_compress == expected.min_dimer_to_compress &&
+                   header.max_dimer_size == expected.max_dimer_size && header.dimer_step == expected.dimer_step;
+        }
+    };
+
+    class ReadCacheWriter {
+    private:
+        std::experimental::filesystem::path file_name;
+        std::ofstream os;
+        ReadCache::Header header;
+        std::vector<uint64_t> index;
+        std::vector<uint64_t> words;
+        uint64_t pos = sizeof(ReadCache::Header);
+    public:
+        ReadCacheWriter(std::experimental::filesystem::path _file_name, const ReadCache::Header &_header) :
+                file_name(std::move(_file_name)), os(file_name, std::ios::binary), header(_header) {
+            ReadCache::Header empty = {};
+            os.write(reinterpret_cast<const char *>(&empty), sizeof(empty));
+        }
+
+//        Read should already be compressed. Characters other than ACGT are stored as A, the same way as Sequence is
+//        built from a compressed read, and cached reads are not compressed again.
+        void write(StringContig &read) {
+            std::string name = read.comment.empty() ? read.id : read.id + " " + read.comment;
+            uint64_t sizes[2] = {read.seq.size(), name.size()};
+            index.push_back(pos);
+            os.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+            name.resize((name.size() + 7) / 8 * 8, '\0');
+            os.write(name.data(), name.size());
+            words.clear();
+            read.makeSequence().writePacked(words);
+            os.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+            pos += sizeof(sizes) + name.size() + words.size() * sizeof(uint64_t);
+        }
+
+        void close() {
+            header.reads = index.size();
+            header.index_offset = pos;
+            os.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(uint64_t));
+            os.seekp(0);
+            os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            os.close();
+            VERIFY_MSG(!os.fail(), "Failed to write read cache " + file_name.string());
+        }
+    };
+
+//    Maps read cache into memory and decodes its records
+    class ReadCacheReader {
+    private:
+        const char *data = nullptr;
+        size_t file_size = 0;
+        const ReadCache::Header *header = nullptr;
+        const uint64_t *index = nullptr;
+    public:
+        explicit ReadCacheReader(const std::experimental::filesystem::path &file_name) {
+            int fd = open(file_name.c_str(), O_RDONLY);
+            VERIFY_MSG(fd >= 0, "Failed to open read cache " + file_name.string());
+            struct stat st = {};
+            VERIFY(fstat(fd, &st) == 0);
+            file_size = st.st_size;
+            VERIFY_MSG(file_size >= sizeof(ReadCache::Header), "Read cache is truncated");
+            void *map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            VERIFY_MSG(map != MAP_FAILED, "Failed to map read cache " + file_name.string());
+            madvise(map, file_size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(map);
+            header = reinterpret_cast<const ReadCache::Header *>(data);
+            VERIFY_MSG(std::equal(ReadCache::magic, ReadCache::magic + 8, header->magic), "Incorrect read cache format");
+            VERIFY_MSG(header->index_offset + header->reads * sizeof(uint64_t) == file_size, "Read cache is truncated");
+            index = reinterpret_cast<const uint64_t *>(data + header->index_offset);
+        }
+
+        ReadCacheReader(const ReadCacheReader &) = delete;
+
+        size_t size() const {
+            return header->reads;
+        }
+
+        StringContig get(size_t i) const {
+            const auto *sizes = reinterpret_cast<const uint64_t *>(data + index[i]);
+            const char *name = reinterpret_cast<const char *>(sizes + 2);
+            const auto *words = reinterpret_cast<const uint64_t *>(name + (sizes[1] + 7) / 8 * 8);
+            return {Sequence::FromPacked(words, sizes[0]), std::string(name, sizes[1])};
+        }
+
+        ~ReadCacheReader() {
+            munmap(const_cast<char *>(data), file_size);
+        }
+    };
+}
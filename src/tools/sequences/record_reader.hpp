@@ -0,0 +1,410 @@
+#pragma once
+
+#include "contigs.hpp"
+#include "read_cache.hpp"
+#include "common/bounded_queue.hpp"
+#include "common/string_utils.hpp"
+#include "common/verify.hpp"
+#include <zlib.h>
+#include <experimental/filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace io {
+
+//    Source of decompressed file contents. read returns number of bytes written to buf and 0 at the end of file.
+    class ByteSource {
+    public:
+        virtual size_t read(char *buf, size_t size) = 0;
+        virtual ~ByteSource() = default;
+    };
+
+    class PlainSource : public ByteSource {
+    private:
+        FILE *file;
+    public:
+        explicit PlainSource(const std::experimental::filesystem::path &file_name) : file(fopen(file_name.c_str(), "rb")) {
+            VERIFY_MSG(file != nullptr, "Failed to open file " + file_name.string());
+            setvbuf(file, nullptr, _IONBF, 0);
+        }
+
+        size_t read(char *buf, size_t size) override {
+            return fread(buf, 1, size, file);
+        }
+
+        ~PlainSource() override {
+            fclose(file);
+        }
+    };
+
+//    Sequential decompression of gzip files. Concatenated gzip members are supported by zlib.
+    class GzipSource : public ByteSource {
+    private:
+        gzFile file;
+    public:
+        explicit GzipSource(const std::experimental::filesystem::path &file_name) : file(gzopen(file_name.c_str(), "rb")) {
+            VERIFY_MSG(file != nullptr, "Failed to open file " + file_name.string());
+            gzbuffer(file, 1u << 20u);
+        }
+
+        size_t read(char *buf, size_t size) override {
+            int res = gzread(file, buf, unsigned(std::min<size_t>(size, 1u << 30u)));
+            VERIFY_MSG(res >= 0, "Failed to decompress gzip file");
+            return res;
+        }
+
+        ~GzipSource() override {
+            gzclose(file);
+        }
+    };
+
+//    BGZF files consist of independent gzip members that store their compressed size in the header.
+//    Batches of members are read sequentially and decompressed by a pool of threads that lives as long as the source.
+    class BgzfSource : public ByteSource {
+    private:
+        FILE *file;
+        size_t threads;
+        size_t batch_size;
+        std::vector<std::string> compressed;
+        std::vector<std::string> decompressed;
+        size_t cur_block = 0;
+        size_t cur_pos = 0;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable batch_ready;
+        std::condition_variable batch_done;
+        std::atomic<size_t> next_block{0};
+        size_t generation = 0;
+        size_t running = 0;
+        bool stopped = false;
+
+        static size_t readLE16(const unsigned char *data) {
+            return size_t(data[0]) | (size_t(data[1]) << 8u);
+        }
+
+//        Returns size of BGZF block with given header or 0 if header does not belong to BGZF block
+        static size_t blockSize(const unsigned char *header, size_t header_size) {
+            if(header_size < 12 || header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4u) == 0)
+                return 0;
+            size_t xlen = readLE16(header + 10);
+            size_t pos = 12;
+            while(pos + 4 <= std::min(header_size, 12 + xlen)) {
+                size_t slen = readLE16(header + pos + 2);
+                if(header[pos] == 'B' && header[pos + 1] == 'C' && slen == 2 && pos + 6 <= header_size)
+                    return readLE16(header + pos + 4) + 1;
+                pos += 4 + slen;
+            }
+            return 0;
+        }
+
+        static std::string inflateBlock(const std::string &block) {
+            const auto *data = reinterpret_cast<const unsigned char *>(block.data());
+            size_t isize = size_t(data[block.size() - 4]) | (size_t(data[block.size() - 3]) << 8u) |
+                           (size_t(data[block.size() - 2]) << 16u) | (size_t(data[block.size() - 1]) << 24u);
+            std::string res(isize, '\0');
+            z_stream strm = {};
+            VERIFY(inflateInit2(&strm, 15 + 16) == Z_OK);
+            strm.next_in = const_cast<Bytef *>(data);
+            strm.avail_in = block.size();
+            strm.next_out = reinterpret_cast<Bytef *>(&res[0]);
+            strm.avail_out = isize;
+            int ret = inflate(&strm, Z_FINISH);
+            inflateEnd(&strm);
+            VERIFY_MSG(ret == Z_STREAM_END && strm.avail_out == 0, "Corrupted BGZF block");
+            return std::move(res);
+        }
+
+        void work() {
+            size_t seen = 0;
+            while(true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    batch_ready.wait(lock, [this, seen] {return stopped || generation != seen;});
+                    if(stopped)
+                        return;
+                    seen = generation;
+                }
+                for(size_t i = next_block++; i < compressed.size(); i = next_block++)
+                    decompressed[i] = inflateBlock(compressed[i]);
+                std::unique_lock<std::mutex> lock(mutex);
+                running -= 1;
+                if(running == 0)
+                    batch_done.notify_one();
+            }
+        }
+
+        bool fillBatch() {
+            compressed.clear();
+            cur_block = 0;
+            cur_pos = 0;
+            unsigned char header[18];
+            while(compressed.size() < batch_size) {
+                size_t header_size = fread(header, 1, sizeof(header), file);
+                if(header_size == 0)
+                    break;
+                size_t block_size = blockSize(header, header_size);
+                VERIFY_MSG(block_size >= sizeof(header), "Incorrect BGZF block header");
+                std::string block(block_size, '\0');
+                std::copy(header, header + sizeof(header), block.begin());
+                VERIFY_MSG(fread(&block[sizeof(header)], 1, block_size - sizeof(header), file) == block_size - sizeof(header),
+                           "BGZF file is truncated");
+                compressed.emplace_back(std::move(block));
+            }
+            if(compressed.empty())
+                return false;
+            decompressed.resize(compressed.size());
+            next_block = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            generation += 1;
+            running = workers.size();
+            batch_ready.notify_all();
+            batch_done.wait(lock, [this] {return running == 0;});
+            return true;
+        }
+
+    public:
+        BgzfSource(const std::experimental::filesystem::path &file_name, size_t _threads) :
+                file(fopen(file_name.c_str(), "rb")), threads(std::max<size_t>(_threads, 1)), batch_size(threads * 16) {
+            VERIFY_MSG(file != nullptr, "Failed to open file " + file_name.string());
+            for(size_t t = 0; t < threads; t++)
+                workers.emplace_back([this] {work();});
+        }
+
+        BgzfSource(const BgzfSource &) = delete;
+
+        static bool IsBgzf(const std::experimental::filesystem::path &file_name) {
+            unsigned char header[18];
+            FILE *file = fopen(file_name.c_str(), "rb");
+            if(file == nullptr)
+                return false;
+            size_t header_size = fread(header, 1, sizeof(header), file);
+            fclose(file);
+            return blockSize(header, header_size) != 0;
+        }
+
+        size_t read(char *buf, size_t size) override {
+            size_t res = 0;
+            while(res < size) {
+                if(cur_block == decompressed.size() && !fillBatch()) {
+                    decompressed.clear();
+                    break;
+                }
+                const std::string &block = decompressed[cur_block];
+                size_t len = std::min(size - res, block.size() - cur_pos);
+                std::copy(block.begin() + cur_pos, block.begin() + cur_pos + len, buf + res);
+                res += len;
+                cur_pos += len;
+                if(cur_pos == block.size()) {
+                    cur_block += 1;
+                    cur_pos = 0;
+                }
+            }
+            return res;
+        }
+
+        ~BgzfSource() override {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stopped = true;
+                batch_ready.notify_all();
+            }
+            for(std::thread &worker : workers)
+                worker.join();
+            fclose(file);
+        }
+    };
+
+    inline std::unique_ptr<ByteSource> OpenSource(const std::experimental::filesystem::path &file_name, size_t threads) {
+        if(!endsWith(file_name, ".gz"))
+            return std::unique_ptr<ByteSource>(new PlainSource(file_name));
+        if(BgzfSource::IsBgzf(file_name))
+            return std::unique_ptr<ByteSource>(new BgzfSource(file_name, threads));
+        return std::unique_ptr<ByteSource>(new GzipSource(file_name));
+    }
+
+//    Splits contents of a source into lines using large buffered reads. Line end symbols are not included in lines.
+    class LineReader {
+    private:
+        ByteSource &source;
+        std::vector<char> buf;
+        size_t pos = 0;
+        size_t end = 0;
+        bool eof = false;
+
+        void refill() {
+            if(pos > 0) {
+                std::copy(buf.begin() + pos, buf.begin() + end, buf.begin());
+                end -= pos;
+                pos = 0;
+            }
+            if(end == buf.size())
+                buf.resize(buf.size() * 2);
+            size_t len = source.read(buf.data() + end, buf.size() - end);
+            end += len;
+            eof = len == 0;
+        }
+
+    public:
+        explicit LineReader(ByteSource &_source, size_t buffer_size = 1u << 24u) : source(_source), buf(buffer_size) {
+        }
+
+//        Line data stays valid until the next call to nextLine or peek
+        bool nextLine(const char *&line, size_t &len) {
+            while(true) {
+                const char *start = buf.data() + pos;
+                const auto *nl = static_cast<const char *>(memchr(start, '\n', end - pos));
+                if(nl != nullptr) {
+                    line = start;
+                    len = nl - start;
+                    pos += len + 1;
+                    return true;
+                }
+                if(eof) {
+                    if(pos == end)
+                        return false;
+                    line = start;
+                    len = end - pos;
+                    pos = end;
+                    return true;
+                }
+                refill();
+            }
+        }
+
+        int peek() {
+            while(pos == end && !eof)
+                refill();
+            return pos == end ? EOF : buf[pos];
+        }
+    };
+
+//    Parses FASTA/FASTQ records or decodes read cache in a dedicated thread and passes them to the consumer in batches through a bounded queue.
+    class AsyncRecordReader {
+    public:
+        typedef std::vector<StringContig> Batch;
+    private:
+        BoundedQueue<Batch> queue;
+        std::thread worker;
+
+        static void trimLine(const char *&line, size_t &len) {
+            while(len > 0 && isspace(line[len - 1]))
+                len--;
+            while(len > 0 && isspace(line[0])) {
+                line++;
+                len--;
+            }
+        }
+
+//        Returns false if the consumer stopped reading
+        bool add(StringContig &&contig, size_t batch_length, size_t batch_size, Batch &batch, size_t &batch_len) {
+            batch_len += contig.size();
+            batch.emplace_back(std::move(contig));
+            if(batch_len >= batch_length || batch.size() >= batch_size) {
+                if(!queue.push(std::move(batch)))
+                    return false;
+                batch = Batch();
+                batch_len = 0;
+            }
+            return true;
+        }
+
+        bool readFile(const std::experimental::filesystem::path &file_name, size_t threads,
+                      size_t batch_length, size_t batch_size, Batch &batch, size_t &batch_len) {
+            if(!std::experimental::filesystem::is_regular_file(file_name)) {
+                std::cerr << "Error: file does not exist " << file_name << std::endl;
+            }
+            VERIFY(std::experimental::filesystem::is_regular_file(file_name));
+            if(ReadCache::IsCache(file_name))
+                return readCache(file_name, batch_length, batch_size, batch, batch_len);
+            bool fastq = endsWith(file_name, "fastq") || endsWith(file_name, "fq") ||
+                         endsWith(file_name, "fastq.gz") || endsWith(file_name, "fq.gz");
+            std::unique_ptr<ByteSource> source = OpenSource(file_name, threads);
+            LineReader reader(*source);
+            const char *line;
+            size_t len;
+            while(reader.nextLine(line, len)) {
+                trimLine(line, len);
+                if(len == 0)
+                    continue;
+                std::string id(line + 1, len - 1);
+                std::string seq;
+                while(reader.peek() != EOF && reader.peek() != '>' && reader.peek() != '+') {
+                    reader.nextLine(line, len);
+                    trimLine(line, len);
+                    if(len == 0)
+                        break;
+                    seq.append(line, len);
+                }
+                if(fastq) {
+                    reader.nextLine(line, len);
+                    size_t qlen = 0;
+                    while(qlen < seq.size() && reader.nextLine(line, len)) {
+                        trimLine(line, len);
+                        if(len == 0)
+                            break;
+                        qlen += len;
+                    }
+                }
+                if(seq.empty())
+                    continue;
+                if(!add(StringContig(std::move(seq), trim(id)), batch_length, batch_size, batch, batch_len))
+                    return false;
+            }
+            return true;
+        }
+
+        bool readCache(const std::experimental::filesystem::path &file_name,
+                       size_t batch_length, size_t batch_size, Batch &batch, size_t &batch_len) {
+            ReadCacheReader reader(file_name);
+            for(size_t i = 0; i < reader.size(); i++) {
+                if(!add(reader.get(i), batch_length, batch_size, batch, batch_len))
+                    return false;
+            }
+            return true;
+        }
+
+        void run(const std::vector<std::experimental::filesystem::path> &lib, size_t threads, size_t batch_length, size_t batch_size) {
+            Batch batch;
+            size_t batch_len = 0;
+            bool ok = true;
+            for(const std::experimental::filesystem::path &file_name : lib) {
+                ok = readFile(file_name, threads, batch_length, batch_size, batch, batch_len);
+                if(!ok)
+                    break;
+            }
+            if(ok && !batch.empty())
+                queue.push(std::move(batch));
+            queue.close();
+        }
+
+    public:
+        AsyncRecordReader(const std::vector<std::experimental::filesystem::path> &lib, size_t threads,
+                          size_t batch_length = 1u << 24u, size_t batch_size = 1u << 14u, size_t queue_size = 8) :
+                queue(queue_size), worker([this, lib, threads, batch_length, batch_size] {
+                    run(lib, threads, batch_length, batch_size);
+                }) {
+        }
+
+        AsyncRecordReader(const AsyncRecordReader &) = delete;
+
+//        Returns false when all records were read
+        bool pop(Batch &batch) {
+            return queue.pop(batch);
+        }
+
+        ~AsyncRecordReader() {
+            queue.close();
+            worker.join();
+        }
+    };
+}
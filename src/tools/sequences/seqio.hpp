@@ -1,7 +1,8 @@
 #pragma once
 
 #include "common/string_utils.hpp"
-#include "stream.hpp"
+#include "common/logging.hpp"
+#include "record_reader.hpp"
 #include "contigs.hpp"
 #include <experimental/filesystem>
 #include <iterator>
@@ -62,7 +63,13 @@ namespace io {
     };
 
     template<class Reader>
-    class SeqIterator : public std::iterator<std::forward_iterator_tag, Sequence, size_t, Sequence *, Sequence&> {
+    class SeqIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Sequence value_type;
+        typedef size_t difference_type;
+        typedef Sequence *pointer;
+        typedef Sequence &reference;
     private:
         Reader &reader;
         bool isend;
@@ -112,72 +119,24 @@ namespace io {
                 choose_next_pos(cur_end - overlap);
                 return;
             }
-            while (stream != nullptr){
-                std::string id, seq;
-                std::getline(*stream, id);
-                std::getline(*stream, seq);
-                trim(seq);
-                if (!id.empty() and !seq.empty()) {
-                    std::stringstream ss;
-                    ss << seq;
-                    size_t cnt = 0;
-                    while(stream->peek() != EOF && stream->peek() != '>' && stream->peek() != '+') {
-                        std::getline(*stream, seq);
-                        trim(seq);
-                        if (seq.empty()) {
-                            next = {};
-                            break;
-                        }
-                        ss << seq;
-                        cnt += 1;
-                    }
-                    next = {ss.str(), std::move(trim(id.substr(1, id.size() - 1)))};
-                    choose_next_pos(0);
+            while(batch_pos == batch.size()) {
+                batch.clear();
+                batch_pos = 0;
+                if(reader == nullptr || !reader->pop(batch)) {
+                    next = StringContig();
                     cur_start = 0;
-                    if(fastq) {
-                        std::getline(*stream, id);
-                        size_t qlen= 0;
-                        while(!stream->eof() && qlen < next.size()) {
-                            std::getline(*stream, seq);
-                            trim(seq);
-                            qlen += seq.size();
-                            if (seq.empty())
-                                break;
-                        }
-                    }
                     return;
                 }
-                nextFile();
-            }
-            next = StringContig();
-            cur_start = 0;
-        }
-
-        void nextFile() {
-            delete stream;
-            if (file_it == lib.end()) {
-                stream = nullptr;
-            } else {
-                std::experimental::filesystem::path file_name = *file_it;
-                if(!std::experimental::filesystem::is_regular_file(file_name)) {
-                    std::cerr << "Error: file does not exist " << file_name << std::endl;
-                }
-                VERIFY(std::experimental::filesystem::is_regular_file(file_name));
-                if (endsWith(file_name, ".gz")) {
-                    stream = new gzstream::igzstream(file_name.c_str());
-                    fastq = endsWith(file_name, "fastq.gz") or endsWith(file_name, "fq.gz");
-                } else {
-                    stream = new std::ifstream(file_name);
-                    fastq = endsWith(file_name, "fastq") or endsWith(file_name, "fq");
-                }
-                ++file_it;
             }
+            next = std::move(batch[batch_pos]);
+            batch_pos += 1;
+            choose_next_pos(0);
         }
 
         const Library lib;
-        Library::const_iterator file_it;
-        std::istream * stream{};
-        bool fastq{};
+        std::unique_ptr<AsyncRecordReader> reader;
+        AsyncRecordReader::Batch batch;
+        size_t batch_pos = 0;
         size_t min_read_size;
         size_t overlap;
         StringContig next{};
@@ -186,9 +145,12 @@ namespace io {
     public:
         friend class ContigIterator<SeqReader>;
         friend class SeqIterator<SeqReader>;
+//        Size of the thread pool that decompresses BGZF input. It is set by --decompression-threads and does not depend
+//        on --threads. Records are parsed by one background thread per reader.
+        static inline size_t decompression_threads = 4;
 
         explicit SeqReader(Library _lib, size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8) :
-                lib(std::move(_lib)), file_it(lib.begin()), min_read_size(_min_read_size), overlap(_overlap) {
+                lib(std::move(_lib)), min_read_size(_min_read_size), overlap(_overlap) {
             VERIFY(min_read_size >= overlap * 2);
             reset();
         }
@@ -199,8 +161,10 @@ namespace io {
         }
 
         void reset() {
-            file_it = lib.begin();
-            nextFile();
+            reader.reset();
+            reader.reset(new AsyncRecordReader(lib, decompression_threads));
+            batch.clear();
+            batch_pos = 0;
             cur_start = 0;
             cur_end = 0;
             inner_read();
@@ -235,6 +199,8 @@ namespace io {
         StringContig get() {
             StringContig tmp;
             if(cur_start != 0 || cur_end != next.size()) {
+                if(!next.packed.empty())
+                    return StringContig(next.packed.Subseq(cur_start, cur_end), next.id + "_" + std::to_string(cur_start));
                 return StringContig(next.seq.substr(cur_start, cur_end - cur_start), next.id + "_" + std::to_string(cur_start));
             } else {
                 return std::move(next);
@@ -266,12 +232,31 @@ namespace io {
         bool eof() {
             return next.isNull();
         }
-
-        ~SeqReader() {
-            delete stream;
-        }
     };
 
+
+//    Converts reads into a binary cache of compressed reads unless a cache built from the same files with the same
+//    compression parameters already exists. Returns library that consists of the cache file.
+    inline Library CacheReads(const Library &lib, const std::experimental::filesystem::path &cache_file, logging::Logger &logger) {
+        ReadCache::Header header = ReadCache::MakeHeader(lib);
+        if(ReadCache::Matches(cache_file, header)) {
+            logger.info() << "Using existing read cache " << cache_file << std::endl;
+            return {cache_file};
+        }
+        logger.info() << "Converting reads into binary read cache " << cache_file << std::endl;
+        ReadCacheWriter writer(cache_file, header);
+        size_t cnt = 0;
+        size_t total_len = 0;
+        for(StringContig read : SeqReader(lib)) {
+            read.compress();
+            writer.write(read);
+            cnt += 1;
+            total_len += read.size();
+        }
+        writer.close();
+        logger.info() << "Saved " << cnt << " reads of total compressed length " << total_len << " to read cache" << std::endl;
+        return {cache_file};
+    }
 }
 
 inline io::Library operator+(const io::Library &lib1, const io::Library &lib2) {
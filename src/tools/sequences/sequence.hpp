@@ -5,10 +5,14 @@
 #include "nucl.hpp"
 #include "IntrusiveRefCntPtr.h"
 #include "common/verify.hpp"
+#include <omp.h>
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <cstring>
 #include <sstream>
 
@@ -62,6 +66,9 @@ class Sequence {
     size_t from_;
     size_t size_;
     bool rtl_; // Right to left + complimentary (?)
+//    Packed nucleotides. Sequences that own their buffer keep it alive through data_. Views into memory of
+//    SequenceArena have null data_, so copying them does not touch any reference counter.
+    const ST *bytes_;
     llvm::IntrusiveRefCntPtr<ManagedNuclBuffer> data_;
 
     static size_t DataSize(size_t size) {
@@ -124,11 +131,67 @@ class Sequence {
     }
 
     Sequence(size_t size, int)
-            : from_(0), size_(size), rtl_(false), data_(new ManagedNuclBuffer(size_)) {}
+            : from_(0), size_(size), rtl_(false), data_(new ManagedNuclBuffer(size_)) {
+        bytes_ = data_->data();
+    }
+
+//    View of size nucleotides stored in bytes. Memory is owned by somebody else.
+    Sequence(const ST *bytes, size_t size)
+            : from_(0), size_(size), rtl_(false), bytes_(bytes), data_() {}
+
+//    All empty sequences are views of one word that is never released
+    static const ST *EmptyBytes() {
+        static const ST empty = 0;
+        return &empty;
+    }
+
+    friend class SequenceArena;
+    friend class SequenceBuilder;
 
     //Low level constructor. Handle with care.
     Sequence(const Sequence &seq, size_t from, size_t size, bool rtl)
-            : from_(from), size_(size), rtl_(rtl), data_(seq.data_) {}
+            : from_(from), size_(size), rtl_(rtl), bytes_(seq.bytes_), data_(seq.data_) {}
+
+//    Reverses the order of nucleotides in a word and complements them
+    static ST rcWord(ST x) {
+        x = __builtin_bswap64(x);
+        x = ((x >> 4u) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4u);
+        x = ((x >> 2u) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2u);
+        return ~x;
+    }
+
+//    cnt (1 <= cnt <= STN) nucleotides of the buffer starting from position i, first nucleotide in lowest bits
+    ST rawWord(size_t i, size_t cnt) const {
+        const ST *bytes = bytes_ + (i >> STNBits);
+        size_t offset = i & (STN - 1u);
+        ST res = bytes[0] >> (offset << 1u);
+        if(offset != 0 && offset + cnt > STN)
+            res |= bytes[1] << (STBits - (offset << 1u));
+        if(cnt < STN)
+            res &= (ST(1) << (cnt << 1u)) - 1u;
+        return res;
+    }
+
+//    cnt (1 <= cnt <= STN) nucleotides of the sequence starting from position pos in the format of writePacked
+    ST word(size_t pos, size_t cnt) const {
+        if(!rtl_)
+            return rawWord(from_ + pos, cnt);
+        return rcWord(rawWord(from_ + size_ - pos - cnt, cnt)) >> ((STN - cnt) << 1u);
+    }
+
+//    Writes nucleotides of the sequence to packed words out starting from nucleotide position pos. Bits of out
+//    corresponding to positions from pos to pos + size() must be zero.
+    void writePackedAt(ST *out, size_t pos) const {
+        for(size_t i = 0; i < size_; i += STN) {
+            size_t cnt = std::min(STN, size_ - i);
+            ST data = word(i, cnt);
+            size_t offset = (pos + i) & (STN - 1u);
+            ST *to = out + ((pos + i) >> STNBits);
+            to[0] |= data << (offset << 1u);
+            if(offset != 0 && offset + cnt > STN)
+                to[1] |= data >> (STBits - (offset << 1u));
+        }
+    }
 
 public:
     /**
@@ -162,13 +225,46 @@ public:
     }
 
     Sequence()
-            : Sequence(size_t(0), 0) {
-        memset(data_->data(), 0, DataSize(size_));
+            : Sequence(EmptyBytes(), 0) {
     }
 
     Sequence(const Sequence &s)
             : Sequence(s, s.from_, s.size_, s.rtl_) {}
 
+//    Restores sequence from words in the format produced by writePacked
+    static Sequence FromPacked(const u_int64_t *words, size_t size) {
+        Sequence res(size, 0);
+        std::copy(words, words + DataSize(size), res.data_->data());
+        return res;
+    }
+
+    static size_t PackedSize(size_t size) {
+        return DataSize(size);
+    }
+
+//    Appends 2-bit packed representation of the sequence (32 nucleotides per word, first nucleotide in lowest bits) to out
+    void writePacked(std::vector<u_int64_t> &out) const {
+        size_t pos = out.size();
+        out.resize(pos + DataSize(size_));
+        writePacked(out.data() + pos);
+    }
+
+//    Writes PackedSize(size()) words of packed representation to out
+    void writePacked(u_int64_t *out) const {
+        size_t words = DataSize(size_);
+        if(words == 0)
+            return;
+        if(!rtl_ && (from_ & (STN - 1u)) == 0) {
+            const ST *bytes = bytes_ + (from_ >> STNBits);
+            std::copy(bytes, bytes + words, out);
+            if((size_ & (STN - 1u)) != 0)
+                out[words - 1] &= (ST(1) << ((size_ & (STN - 1u)) << 1u)) - 1u;
+            return;
+        }
+        for(size_t i = 0; i < words; i++)
+            out[i] = word(i << STNBits, std::min(STN, size_ - (i << STNBits)));
+    }
+
     static Sequence Concat(const std::vector<Sequence> &v) {
         std::stringstream ss;
         for(const auto &seq : v) {
@@ -184,6 +280,7 @@ public:
         from_ = rhs.from_;
         size_ = rhs.size_;
         rtl_ = rhs.rtl_;
+        bytes_ = rhs.bytes_;
         data_ = rhs.data_;
 
         return *this;
@@ -197,7 +294,7 @@ public:
 
     unsigned char operator[](const size_t index) const {
         VERIFY(index < size_);
-        const ST *bytes = data_->data();
+        const ST *bytes = bytes_;
         if (rtl_) {
             size_t i = from_ + size_ - 1 - index;
             return complement((bytes[i >> STNBits] >> ((i & (STN - 1u)) << 1u)) & 3u);
@@ -209,7 +306,7 @@ public:
 
     size_t asNumber() const {
         size_t res = 0;
-        const ST *bytes = data_->data();
+        const ST *bytes = bytes_;
         if (rtl_) {
             for(size_t i = from_ + size_ - 1; i + 1 >= from_ + 1; i++) {
                 res = (res << 2u) + (complement((bytes[i >> STNBits] >> ((i & (STN - 1u)) << 1u)) & 3u));
@@ -227,26 +324,19 @@ public:
         if (size_ != that.size_)
             return false;
 
-        if (data_ == that.data_ && from_ == that.from_ && rtl_ == that.rtl_)
+        if (bytes_ == that.bytes_ && from_ == that.from_ && rtl_ == that.rtl_)
             return true;
 
-        for (size_t i = 0; i < size_; ++i) {
-            if (this->operator[](i) != that[i]) {
-                return false;
-            }
-        }
-        return true;
+        return matchLength(that, 0, 0, size_) == size_;
     }
 
+//    Note that a sequence is less than its proper prefix
     bool operator<(const Sequence &other) const {
-        for (size_t i = 0; i < size_; ++i) {
-            if (i == other.size())
-                return true;
-            else if (this->operator[](i) != other[i]) {
-                return this->operator[](i) < other[i];
-            }
-        }
-        return false;
+        size_t len = std::min(size_, other.size_);
+        size_t res = matchLength(other, 0, 0, len);
+        if (res < len)
+            return this->operator[](res) < other[res];
+        return size_ > other.size_;
     }
 
     bool operator<=(const Sequence &other) const {
@@ -306,16 +396,21 @@ public:
     }
 
     bool startsWith(const Sequence & other) const {
-        return (other.size() <= size()) && (Subseq(0, other.size()) == other);
+        return (other.size() <= size()) && matchLength(other, 0, 0, other.size()) == other.size();
     }
 
     bool endsWith(const Sequence & other) const {
-        return (other.size() <= size()) && (Subseq(size() - other.size(), size()) == other);
+        return (other.size() <= size()) && matchLength(other, size() - other.size(), 0, other.size()) == other.size();
     }
 
     bool nonContradicts(const Sequence & other) const {
         size_t ms = std::min(size(), other.size());
-        return Subseq(0, ms) == other.Subseq(0, ms);
+        return matchLength(other, 0, 0, ms) == ms;
+    }
+
+    bool contains(const Sequence &s, size_t offset = 0) const {
+        VERIFY(offset + s.size() <= size());
+        return matchLength(s, offset, 0, s.size()) == s.size();
     }
 
     template<class Seq>
@@ -333,11 +428,20 @@ public:
         return Sequence(*this, from_, size_, !rtl_);
     }
 
+//    Length of common prefix of len nucleotides of this sequence starting from pos and of other starting from other_pos.
+//    Compares whole words and finds the first differing nucleotide by the lowest set bit of their xor.
+    size_t matchLength(const Sequence &other, size_t pos, size_t other_pos, size_t len) const {
+        for(size_t i = 0; i < len; i += STN) {
+            size_t cnt = std::min(STN, len - i);
+            ST diff = word(pos + i, cnt) ^ other.word(other_pos + i, cnt);
+            if(diff != 0)
+                return i + (__builtin_ctzll(diff) >> 1u);
+        }
+        return len;
+    }
+
     size_t commonPrefix(const Sequence & other) const {
-        size_t res = 0;
-        while(res < size() && res < other.size() && this->operator[](res) == other[res])
-            res += 1;
-        return res;
+        return matchLength(other, 0, 0, std::min(size(), other.size()));
     }
 
     Sequence makeSequence() {
@@ -377,11 +481,8 @@ Sequence Sequence::Suffix(size_t count) const {
 }
 
 
-/**
- * @todo optimize sequence copy
- */
 Sequence Sequence::operator+(const Sequence &s) const {
-    if (data_ == s.data_ && rtl_ == s.rtl_ &&
+    if (bytes_ == s.bytes_ && rtl_ == s.rtl_ &&
             (
                 (!rtl_ && this->from_ + size_ == s.from_ ) ||
                 (rtl_ && this->from_ == s.from_ + s.size_)
@@ -390,7 +491,12 @@ Sequence Sequence::operator+(const Sequence &s) const {
     {
         return Sequence(*this, std::min(from_, s.from_), size_ + s.size_, rtl_);
     } else {
-        return Sequence(str() + s.str());
+        Sequence res(size_ + s.size_, 0);
+        ST *out = res.data_->data();
+        writePacked(out);
+        std::fill(out + DataSize(size_), out + DataSize(res.size_), 0);
+        s.writePackedAt(out, size_);
+        return res;
     }
 }
 
@@ -405,7 +511,7 @@ std::string Sequence::str() const {
 
 std::string Sequence::err() const {
     std::ostringstream oss;
-    oss << "{ *data=" << data_->data() <<
+    oss << "{ *data=" << bytes_ <<
         ", from_=" << from_ <<
         ", size_=" << size_ <<
         ", rtl_=" << int(rtl_) << " }";
@@ -417,13 +523,100 @@ std::ostream &operator<<(std::ostream &os, const Sequence &s) {
     return os;
 }
 
+//Stores packed copies of many small sequences in large blocks instead of a separate buffer for each of them.
+//Copies are views without reference counting, so they are valid only while the arena exists. Arena of a graph lives
+//as long as the graph. Every thread fills its own block, so copies can be made in parallel without locks.
+class SequenceArena {
+private:
+    typedef u_int64_t ST;
+    static const size_t block_words = size_t(1) << 16u;
+    static const size_t max_threads = 1024;
+
+    struct alignas(64) Block {
+        ST *buffer = nullptr;
+        size_t used = 0;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<std::unique_ptr<ST[]>> owned;
+    std::unique_ptr<std::mutex> owned_lock;
+
+//    Small index that is given to a thread when it first uses any arena. Unlike omp_get_thread_num it is different for
+//    threads of nested parallel regions and for threads that are not managed by OpenMP.
+    static size_t threadSlot() {
+        static std::atomic<size_t> next_slot(0);
+        thread_local size_t slot = next_slot++;
+        VERIFY_MSG(slot < max_threads, "Too many threads use SequenceArena");
+        return slot;
+    }
+
+    Sequence allocate(size_t size, ST *&out) {
+        size_t words = Sequence::DataSize(size);
+        if(words > block_words / 16) {
+            Sequence res(size, 0);
+            out = res.data_->data();
+            return res;
+        }
+        Block &block = blocks[threadSlot()];
+        if(block.buffer == nullptr || block.used + words > block_words) {
+            block.buffer = new ST[block_words];
+            block.used = 0;
+            std::lock_guard<std::mutex> lock(*owned_lock);
+            owned.emplace_back(block.buffer);
+        }
+        out = block.buffer + block.used;
+        block.used += words;
+        return {out, size};
+    }
+
+public:
+    SequenceArena() : blocks(max_threads), owned_lock(new std::mutex()) {
+    }
+
+    SequenceArena(SequenceArena &&other) = default;
+    SequenceArena &operator=(SequenceArena &&other) = default;
+
+    Sequence copy(const Sequence &seq) {
+        if(seq.empty())
+            return {};
+        ST *out;
+        Sequence res = allocate(seq.size(), out);
+        seq.writePacked(out);
+        return res;
+    }
+
+    Sequence copyPacked(const ST *words, size_t size) {
+        if(size == 0)
+            return {};
+        ST *out;
+        Sequence res = allocate(size, out);
+        std::copy(words, words + Sequence::DataSize(size), out);
+        return res;
+    }
+};
+
+//Collects a sequence from pieces in 2-bit packed form. Sequences are appended word by word without decoding nucleotides.
 class SequenceBuilder {
-    std::vector<char> buf_;
+    typedef u_int64_t ST;
+    std::vector<ST> buf_;
+    size_t size_ = 0;
 public:
+    SequenceBuilder &reserve(size_t size) {
+        buf_.reserve(Sequence::DataSize(size));
+        return *this;
+    }
+
+    SequenceBuilder &append(const Sequence &s) {
+        buf_.resize(Sequence::DataSize(size_ + s.size()), 0);
+        s.writePackedAt(buf_.data(), size_);
+        size_ += s.size();
+        return *this;
+    }
+
     template<typename S>
     SequenceBuilder &append(const S &s) {
         for (size_t i = 0; i < s.size(); ++i) {
-            buf_.push_back(s[i]);
+            append(char(s[i]));
         }
         return *this;
     }
@@ -438,30 +631,40 @@ public:
     }
 
     SequenceBuilder &append(char c) {
-        buf_.push_back(c);
+        if(!is_dignucl(c))
+            c = dignucl(c);
+        if((size_ & (Sequence::STN - 1u)) == 0)
+            buf_.push_back(0);
+        buf_.back() |= ST(c) << ((size_ & (Sequence::STN - 1u)) << 1u);
+        size_ += 1;
         return *this;
     }
 
     Sequence BuildSequence() {
-        return Sequence(buf_);
+        return Sequence::FromPacked(buf_.data(), size_);
+    }
+
+    Sequence BuildSequence(SequenceArena &arena) {
+        return arena.copyPacked(buf_.data(), size_);
     }
 
     size_t size() const {
-        return buf_.size();
+        return size_;
     }
 
     void clear() {
-        return buf_.clear();
+        buf_.clear();
+        size_ = 0;
     }
 
     unsigned char operator[](const size_t index) const {
-        return buf_[index];
+        return (buf_[index >> Sequence::STNBits] >> ((index & (Sequence::STN - 1u)) << 1u)) & 3u;
     }
 
     std::string str() const {
-        std::string s(buf_.size(), '-');
+        std::string s(size_, '-');
         for (size_t i = 0; i < s.size(); ++i) {
-            s[i] = nucl(buf_[i]);
+            s[i] = nucl(operator[](i));
         }
         return s;
     }
@@ -469,6 +672,7 @@ public:
 
 Sequence Sequence::operator*(size_t mult) const {
     SequenceBuilder sb;
+    sb.reserve(size_ * mult);
     for(size_t i = 0; i < mult; i++) {
         sb.append(*this);
     }